@@ -1,15 +1,29 @@
+#include <malloc.h>
+
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <string>
 #include <vector>
 #include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <opencv2/imgproc.hpp>
 
 #include "canny.h"
+#include "canny_batch.h"
+#include "canny_budget.h"
+#include "canny_incremental.h"
 #include "canny_parallel.h"
 
 // Benchmark configuration
 const int NUM_RUNS = 10;  // Number of runs to average
 const int MAX_THREADS = 6;
+const int BATCH_RUNS = 3;  // Runs per batch strategy (each run is a whole batch)
+const int SWEEP_RUNS = 3;  // Timed runs per point of the scaling sweeps (after one warm-up)
 
 struct BenchmarkResult {
     double gaussianTime;
@@ -64,12 +78,9 @@ BenchmarkResult runSingleBenchmark(const std::string& imagePath, int numThreads)
     int sizeCols = img.cols;
     int sizeDepth = img.channels();
     
-    std::vector<std::vector<double>> kernel = {{2.0, 4.0, 5.0, 4.0, 2.0},
-                                               {4.0, 9.0, 12.0, 9.0, 4.0},
-                                               {5.0, 12.0, 15.0, 12.0, 5.0},
-                                               {4.0, 9.0, 12.0, 9.0, 4.0},
-                                               {2.0, 4.0, 5.0, 4.0, 2.0}};
-    double kernelConst = (1.0 / 159.0);
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
     double lowerThreshold = 0.03;
     double higherThreshold = 0.1;
     
@@ -199,9 +210,801 @@ void printTable3() {
     std::cout << "========================================================================================================\n";
 }
 
+// Mixed-size batch built in memory from the base image: many thumbnails,
+// some VGA frames and a few full/double size frames.
+std::vector<cv::Mat> makeMixedBatch(const std::string& imagePath) {
+    std::vector<cv::Mat> images;
+    cv::Mat img = cv::imread(imagePath);
+    if (img.empty()) return images;
+
+    struct { int rows, cols, count; } sizes[] = {
+        {256, 256, 48}, {480, 640, 8}, {img.rows, img.cols, 2}, {img.rows * 2, img.cols * 2, 1}};
+    for (auto& s : sizes) {
+        cv::Mat resized;
+        cv::resize(img, resized, cv::Size(s.cols, s.rows), 0, 0, cv::INTER_AREA);
+        for (int c = 0; c < s.count; c++) images.push_back(resized);
+    }
+    return images;
+}
+
+double runBatchBenchmark(const std::vector<cv::Mat>& images, int numThreads, BatchStrategy strategy) {
+    setNumThreads(numThreads);
+    std::vector<std::vector<int>> edges;
+    double total = 0;
+    for (int run = 0; run < BATCH_RUNS; run++) {
+        BatchStats stats;
+        cannyBatch_parallel(images, edges, 0.03, 0.1, strategy, DEFAULT_SPLIT_PIXELS, &stats);
+        total += stats.totalTime;
+    }
+    return total / BATCH_RUNS;
+}
+
+void printTable4(const std::string& imagePath) {
+    std::vector<cv::Mat> images = makeMixedBatch(imagePath);
+    if (images.empty()) return;
+    double megapixels = 0;
+    for (const cv::Mat& img : images) megapixels += img.rows * img.cols / 1e6;
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 4: Mixed-Size Batch Scheduling (" << images.size() << " images, " 
+              << std::fixed << std::setprecision(2) << megapixels << " MP, split at >= " 
+              << DEFAULT_SPLIT_PIXELS << " px)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(10) << "Threads" 
+              << std::setw(20) << "hybrid (MP/s)"
+              << std::setw(20) << "image-level (MP/s)"
+              << std::setw(20) << "intra-image (MP/s)"
+              << std::setw(16) << "vs image"
+              << std::setw(16) << "vs intra" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    for (int t = 1; t <= MAX_THREADS; t++) {
+        double hybrid = runBatchBenchmark(images, t, BATCH_HYBRID);
+        double imageLevel = runBatchBenchmark(images, t, BATCH_IMAGE_LEVEL);
+        double intraImage = runBatchBenchmark(images, t, BATCH_INTRA_IMAGE);
+        std::cout << std::setw(10) << t 
+                  << std::setw(20) << std::fixed << std::setprecision(2) << megapixels * 1000.0 / hybrid
+                  << std::setw(20) << std::fixed << std::setprecision(2) << megapixels * 1000.0 / imageLevel
+                  << std::setw(20) << std::fixed << std::setprecision(2) << megapixels * 1000.0 / intraImage
+                  << std::setw(16) << std::fixed << std::setprecision(2) << imageLevel / hybrid
+                  << std::setw(16) << std::fixed << std::setprecision(2) << intraImage / hybrid << "\n";
+    }
+    std::cout << "========================================================================================================\n";
+}
+
+// Agreement of an edge map with a reference (edge = non-zero output)
+struct EdgeOverlap {
+    double precision;
+    double recall;
+    double iou;
+};
+
+EdgeOverlap compareEdges(const std::vector<int>& reference, const std::vector<int>& edges) {
+    long long both = 0, onlyEdges = 0, onlyReference = 0;
+    for (size_t i = 0; i < edges.size(); i++) {
+        bool r = reference[i] > 0;
+        bool e = edges[i] > 0;
+        both += r && e;
+        onlyEdges += e && !r;
+        onlyReference += r && !e;
+    }
+    EdgeOverlap overlap;
+    overlap.precision = both + onlyEdges ? (double)both / (both + onlyEdges) : 1.0;
+    overlap.recall = both + onlyReference ? (double)both / (both + onlyReference) : 1.0;
+    overlap.iou = both + onlyEdges + onlyReference ? (double)both / (both + onlyEdges + onlyReference) : 1.0;
+    return overlap;
+}
+
+// Gray input for the cannyFilter-only benchmarks
+std::vector<int> grayPixelsOf(const cv::Mat& img, int& sizeRows, int& sizeCols) {
+    setNumThreads(1);
+    CannyWorkspace ws;
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+    sizeRows = img.rows;
+    sizeCols = img.cols;
+    std::vector<int> pixels = imgToArray(img, (uint8_t*)img.data, sizeRows, sizeCols, img.channels());
+    std::vector<int> pixelsBlur = gaussianBlur_parallel(pixels, kernel, kernelConst, sizeRows, sizeCols, img.channels());
+    return rgbToGrayscale_parallel(pixelsBlur, sizeRows, sizeCols, img.channels());
+}
+
+std::vector<int> loadGrayPixels(const std::string& imagePath, int& sizeRows, int& sizeCols) {
+    cv::Mat img = cv::imread(imagePath);
+    if (img.empty()) return {};
+    return grayPixelsOf(img, sizeRows, sizeCols);
+}
+
+double timeCannyFilter(std::vector<int>& pixelsGray, int sizeRows, int sizeCols, int numThreads) {
+    setNumThreads(numThreads);
+    double total = 0;
+    for (int run = 0; run < NUM_RUNS; run++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<int> pixelsCanny = cannyFilter_parallel(pixelsGray, sizeRows, sizeCols, 1, 0.03, 0.1);
+        auto end = std::chrono::high_resolution_clock::now();
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    return total / NUM_RUNS;
+}
+
+void printTable5(const std::string& imagePath) {
+    int sizeRows = 0, sizeCols = 0;
+    std::vector<int> pixelsGray = loadGrayPixels(imagePath, sizeRows, sizeCols);
+    if (pixelsGray.empty()) return;
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 5: cannyFilter Precision Modes (quality vs exact, edge = non-zero output, 1 thread)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(12) << "Mode" 
+              << std::setw(16) << "1 thread (ms)"
+              << std::setw(16) << (std::to_string(MAX_THREADS) + " threads (ms)")
+              << std::setw(14) << "Speedup"
+              << std::setw(14) << "Precision"
+              << std::setw(14) << "Recall"
+              << std::setw(14) << "IoU" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    CannyPrecision modes[] = {PRECISION_EXACT, PRECISION_FAST_L1, PRECISION_FAST_L2SQ};
+    std::vector<int> exactEdges;
+    double exactTime = 0;
+    for (CannyPrecision mode : modes) {
+        setPrecisionMode(mode);
+        double time1 = timeCannyFilter(pixelsGray, sizeRows, sizeCols, 1);
+        double timeN = timeCannyFilter(pixelsGray, sizeRows, sizeCols, MAX_THREADS);
+        setNumThreads(1);
+        std::vector<int> edges = cannyFilter_parallel(pixelsGray, sizeRows, sizeCols, 1, 0.03, 0.1);
+        if (mode == PRECISION_EXACT) {
+            exactEdges = edges;
+            exactTime = time1;
+        }
+
+        EdgeOverlap overlap = compareEdges(exactEdges, edges);
+
+        std::cout << std::setw(12) << precisionModeName(mode) 
+                  << std::setw(16) << std::fixed << std::setprecision(2) << time1
+                  << std::setw(16) << std::fixed << std::setprecision(2) << timeN
+                  << std::setw(14) << std::fixed << std::setprecision(2) << exactTime / time1
+                  << std::setw(14) << std::fixed << std::setprecision(4) << overlap.precision
+                  << std::setw(14) << std::fixed << std::setprecision(4) << overlap.recall
+                  << std::setw(14) << std::fixed << std::setprecision(4) << overlap.iou << "\n";
+    }
+    setPrecisionMode(PRECISION_EXACT);
+    std::cout << "========================================================================================================\n";
+}
+
+// Average blur + grayscale time (ms) of the full pipeline in the current mode
+double timeBlurGray(const cv::Mat& img, CannyWorkspace& ws, int numThreads, double& totalTime) {
+    setNumThreads(numThreads);
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+    double blurGray = 0;
+    totalTime = 0;
+    for (int run = 0; run < NUM_RUNS; run++) {
+        double start = getCurrentTimeMs();
+        if (getPipelineMode() == PIPELINE_CHANNEL_FIRST) {
+            ws.pixels = imgToArray(img, (uint8_t*)img.data, img.rows, img.cols, img.channels());
+            gaussianBlur_parallel(ws.pixels, kernel, kernelConst, img.rows, img.cols, img.channels(), ws.pixelsBlur);
+            rgbToGrayscale_parallel(ws.pixelsBlur, img.rows, img.cols, img.channels(), ws.pixelsGray);
+        } else {
+            lumaBlur_parallel(img, getPipelineMode(), kernel, kernelConst, ws.pixels, ws.pixelsBlur, ws.pixelsGray);
+        }
+        blurGray += getCurrentTimeMs() - start;
+
+        start = getCurrentTimeMs();
+        cannyEdgeDetection_parallel(img, ws, 0.03, 0.1);
+        totalTime += getCurrentTimeMs() - start;
+    }
+    totalTime /= NUM_RUNS;
+    return blurGray / NUM_RUNS;
+}
+
+void printTable6(const std::string& imagePath) {
+    cv::Mat img = cv::imread(imagePath);
+    if (img.empty()) return;
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 6: Blur/Grayscale Order (blur + gray and full pipeline, " << MAX_THREADS << " threads)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(16) << "Pipeline" 
+              << std::setw(16) << "Blur+gray (ms)"
+              << std::setw(14) << "Total (ms)"
+              << std::setw(14) << "Speedup"
+              << std::setw(16) << "Max gray diff"
+              << std::setw(14) << "Edge IoU" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    PipelineMode modes[] = {PIPELINE_CHANNEL_FIRST, PIPELINE_LUMA_AVERAGE, PIPELINE_LUMA_BT601};
+    CannyWorkspace ws;
+    std::vector<int> referenceGray;
+    std::vector<int> referenceEdges;
+    double referenceTime = 0;
+    for (PipelineMode mode : modes) {
+        setPipelineMode(mode);
+        double totalTime = 0;
+        double blurGray = timeBlurGray(img, ws, MAX_THREADS, totalTime);
+        setNumThreads(1);
+        cannyEdgeDetection_parallel(img, ws, 0.03, 0.1);
+        if (mode == PIPELINE_CHANNEL_FIRST) {
+            referenceGray = ws.pixelsGray;
+            referenceEdges = ws.pixelsCanny;
+            referenceTime = totalTime;
+        }
+
+        int maxDiff = 0;
+        for (size_t i = 0; i < referenceGray.size(); i++) {
+            maxDiff = std::max(maxDiff, std::abs(referenceGray[i] - ws.pixelsGray[i]));
+        }
+
+        std::cout << std::setw(16) << pipelineModeName(mode) 
+                  << std::setw(16) << std::fixed << std::setprecision(2) << blurGray
+                  << std::setw(14) << std::fixed << std::setprecision(2) << totalTime
+                  << std::setw(14) << std::fixed << std::setprecision(2) << referenceTime / totalTime
+                  << std::setw(16) << maxDiff
+                  << std::setw(14) << std::fixed << std::setprecision(4) 
+                  << compareEdges(referenceEdges, ws.pixelsCanny).iou << "\n";
+    }
+    setPipelineMode(PIPELINE_CHANNEL_FIRST);
+    std::cout << "========================================================================================================\n";
+}
+
+void printTable7(const std::string& imagePath) {
+    cv::Mat img = cv::imread(imagePath);
+    if (img.empty()) return;
+
+    ParallelBackend backends[] = {BACKEND_PTHREAD, BACKEND_OPENMP, BACKEND_STD_PAR, BACKEND_SERIAL};
+    ParallelBackend original = getParallelBackend();
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 7: Parallel Backends (full pipeline, average time in ms)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(10) << "Threads";
+    for (ParallelBackend backend : backends) {
+        std::cout << std::setw(18) << parallelBackendName(backend);
+    }
+    std::cout << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    CannyWorkspace ws;
+    for (int t = 1; t <= MAX_THREADS; t++) {
+        std::cout << std::setw(10) << t;
+        for (ParallelBackend backend : backends) {
+            if (!setParallelBackend(backend)) {
+                std::cout << std::setw(18) << "n/a";
+                continue;
+            }
+            setNumThreads(t);
+            double total = 0;
+            for (int run = 0; run < NUM_RUNS; run++) {
+                double start = getCurrentTimeMs();
+                cannyEdgeDetection_parallel(img, ws, 0.03, 0.1);
+                total += getCurrentTimeMs() - start;
+            }
+            std::cout << std::setw(18) << std::fixed << std::setprecision(2) << total / NUM_RUNS;
+        }
+        std::cout << "\n";
+    }
+    setParallelBackend(original);
+    std::cout << "========================================================================================================\n";
+}
+
+// Peak resident set size (VmHWM) of this process in MB
+double peakRssMb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            std::istringstream in(line.substr(6));
+            double kb = 0;
+            in >> kb;
+            return kb / 1024.0;
+        }
+    }
+    return 0;
+}
+
+// Reset VmHWM to the current RSS (Linux 4.0+), so the next reading is the
+// peak of what runs in between. Free heap pages are returned first so memory
+// released by earlier tables does not count.
+void resetPeakRss() {
+    malloc_trim(0);
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+void printTable8(const std::string& imagePath) {
+    cv::Mat img = cv::imread(imagePath);
+    if (img.empty()) return;
+    double megapixels = img.total() / 1e6;
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 8: Memory Plans (" << MAX_THREADS << " threads, workspace bytes per pixel, first-run allocations in MB)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(16) << "Pipeline"
+              << std::setw(10) << "Memory"
+              << std::setw(12) << "Time (ms)"
+              << std::setw(12) << "Peak B/px"
+              << std::setw(12) << "Kept B/px"
+              << std::setw(10) << "Blur"
+              << std::setw(10) << "Gray"
+              << std::setw(10) << "Canny"
+              << std::setw(16) << "Peak RSS (MB)" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    PipelineMode pipelines[] = {PIPELINE_CHANNEL_FIRST, PIPELINE_LUMA_BT601};
+    MemoryMode memoryModes[] = {MEMORY_DEFAULT, MEMORY_LOW};
+    setNumThreads(MAX_THREADS);
+    for (PipelineMode pipeline : pipelines) {
+        for (MemoryMode memory : memoryModes) {
+            setPipelineMode(pipeline);
+            setMemoryMode(memory);
+
+            // First run on a fresh workspace: allocations and peak RSS
+            resetPeakRss();
+            CannyWorkspace ws;
+            cannyEdgeDetection_parallel(img, ws, 0.03, 0.1);
+            double peakRss = peakRssMb();
+            size_t allocated[NUM_STAGES];
+            std::copy(ws.stageBytes, ws.stageBytes + NUM_STAGES, allocated);
+
+            double total = 0;
+            for (int run = 0; run < NUM_RUNS; run++) {
+                double start = getCurrentTimeMs();
+                cannyEdgeDetection_parallel(img, ws, 0.03, 0.1);
+                total += getCurrentTimeMs() - start;
+            }
+
+            std::cout << std::setw(16) << pipelineModeName(pipeline)
+                      << std::setw(10) << memoryModeName(memory)
+                      << std::setw(12) << std::fixed << std::setprecision(2) << total / NUM_RUNS
+                      << std::setw(12) << std::fixed << std::setprecision(1) << ws.peakBytes / (megapixels * 1e6)
+                      << std::setw(12) << std::fixed << std::setprecision(1) << workspaceBytes(ws) / (megapixels * 1e6);
+            for (int stage = 0; stage < NUM_STAGES; stage++) {
+                std::cout << std::setw(10) << std::fixed << std::setprecision(2) << allocated[stage] / 1e6;
+            }
+            std::cout << std::setw(16) << std::fixed << std::setprecision(1) << peakRss << "\n";
+        }
+    }
+    setPipelineMode(PIPELINE_CHANNEL_FIRST);
+    setMemoryMode(MEMORY_DEFAULT);
+    std::cout << "========================================================================================================\n";
+}
+
+// ============================================================================
+// SYNTHETIC SCALING SWEEP
+// ============================================================================
+
+// Synthetic BGR test image generated in memory: random filled rectangles,
+// circles and lines on a mid-gray background, plus Gaussian noise.
+// edgeDensity is the number of shapes per 64x64 block (1.0 = one per block).
+cv::Mat makeSyntheticImage(int sizeRows, int sizeCols, double noiseSigma, double edgeDensity, unsigned seed) {
+    cv::Mat img(sizeRows, sizeCols, CV_8UC3, cv::Scalar(128, 128, 128));
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> color(0, 255);
+    std::uniform_int_distribution<int> x(0, sizeCols - 1);
+    std::uniform_int_distribution<int> y(0, sizeRows - 1);
+    std::uniform_int_distribution<int> extent(4, 64);
+
+    int numShapes = (int)(edgeDensity * sizeRows * sizeCols / (64.0 * 64.0));
+    for (int n = 0; n < numShapes; n++) {
+        cv::Scalar c(color(rng), color(rng), color(rng));
+        cv::Point p(x(rng), y(rng));
+        switch (n % 3) {
+        case 0:
+            cv::rectangle(img, p, cv::Point(p.x + extent(rng), p.y + extent(rng)), c, -1);
+            break;
+        case 1:
+            cv::circle(img, p, extent(rng) / 2, c, -1);
+            break;
+        default:
+            cv::line(img, p, cv::Point(p.x + extent(rng) * 2, p.y + extent(rng) - 34), c, 2);
+            break;
+        }
+    }
+
+    if (noiseSigma > 0) {
+        std::normal_distribution<double> noise(0.0, noiseSigma);
+        uint8_t* data = (uint8_t*)img.data;
+        for (size_t i = 0; i < img.total() * img.channels(); i++) {
+            data[i] = (uint8_t)std::max(0.0, std::min(255.0, data[i] + noise(rng)));
+        }
+    }
+    return img;
+}
+
+// Per-stage average times (ms) of the channel-first pipeline on an in-memory
+// image, reusing ws so no allocation or codec I/O is timed
+BenchmarkResult timeStagesInMemory(const cv::Mat& img, CannyWorkspace& ws, int numThreads) {
+    setNumThreads(numThreads);
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+    ws.pixels = imgToArray(img, (uint8_t*)img.data, img.rows, img.cols, img.channels());
+
+    BenchmarkResult avg = {0, 0, 0, 0};
+    for (int run = 0; run <= SWEEP_RUNS; run++) {
+        double start = getCurrentTimeMs();
+        gaussianBlur_parallel(ws.pixels, kernel, kernelConst, img.rows, img.cols, img.channels(), ws.pixelsBlur);
+        double blurDone = getCurrentTimeMs();
+        rgbToGrayscale_parallel(ws.pixelsBlur, img.rows, img.cols, img.channels(), ws.pixelsGray);
+        double grayDone = getCurrentTimeMs();
+        cannyFilter_parallel(ws.pixelsGray, img.rows, img.cols, 1, 0.03, 0.1, ws.G, ws.theta, ws.pixelsCanny);
+        double cannyDone = getCurrentTimeMs();
+
+        if (run == 0) continue;  // warm-up
+        avg.gaussianTime += (blurDone - start) / SWEEP_RUNS;
+        avg.grayscaleTime += (grayDone - blurDone) / SWEEP_RUNS;
+        avg.cannyTime += (cannyDone - grayDone) / SWEEP_RUNS;
+        avg.totalTime += (cannyDone - start) / SWEEP_RUNS;
+    }
+    return avg;
+}
+
+// 1, 2, 4, ... up to maxThreads, always including maxThreads
+std::vector<int> sweepThreadCounts(int maxThreads) {
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+// One row of a sweep table: MP/s and parallel efficiency for each stage.
+// idealScale is the work ratio to the baseline (1 for strong scaling, the
+// thread count for weak scaling).
+void printSweepRow(const std::string& label, int numThreads, double megapixels, 
+                   const BenchmarkResult& r, const BenchmarkResult& base, double idealScale) {
+    double times[] = {r.gaussianTime, r.grayscaleTime, r.cannyTime, r.totalTime};
+    double baseTimes[] = {base.gaussianTime, base.grayscaleTime, base.cannyTime, base.totalTime};
+    std::cout << std::setw(12) << label << std::setw(9) << numThreads;
+    for (int s = 0; s < 4; s++) {
+        // Efficiency = achieved speedup over the single-thread baseline / threads
+        double efficiency = times[s] > 0 ? baseTimes[s] * idealScale / (times[s] * numThreads) : 0;
+        std::cout << std::setw(11) << std::fixed << std::setprecision(1) << megapixels * 1000.0 / times[s]
+                  << std::setw(9) << std::fixed << std::setprecision(2) << efficiency;
+    }
+    std::cout << "\n";
+}
+
+void printSweepHeader(const std::string& title) {
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << title << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(12) << "Resolution" << std::setw(9) << "Threads"
+              << std::setw(20) << "Blur MP/s  eff"
+              << std::setw(20) << "Gray MP/s  eff"
+              << std::setw(20) << "Canny MP/s  eff"
+              << std::setw(20) << "Total MP/s  eff" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+}
+
+// Strong scaling (fixed image, more threads) for every resolution, then weak
+// scaling (image grows with the thread count) from the first resolution
+void runScalingSweep(const std::vector<cv::Size>& resolutions, double noiseSigma, double edgeDensity, 
+                     int maxThreads) {
+    std::vector<int> threadCounts = sweepThreadCounts(maxThreads);
+    CannyWorkspace ws;
+
+    std::cout << "Synthetic inputs: noise sigma " << noiseSigma << ", edge density " << edgeDensity 
+              << " shapes per 64x64 block, " << SWEEP_RUNS << " runs per point\n";
+
+    for (const cv::Size& size : resolutions) {
+        cv::Mat img = makeSyntheticImage(size.height, size.width, noiseSigma, edgeDensity, 1);
+        double megapixels = img.total() / 1e6;
+        std::string label = std::to_string(size.width) + "x" + std::to_string(size.height);
+
+        std::ostringstream title;
+        title << "Strong scaling: " << label << " (" << std::fixed << std::setprecision(2) << megapixels << " MP)";
+        printSweepHeader(title.str());
+        BenchmarkResult base = {0, 0, 0, 0};
+        for (int n : threadCounts) {
+            BenchmarkResult r = timeStagesInMemory(img, ws, n);
+            if (n == 1) base = r;
+            printSweepRow(label, n, megapixels, r, base, 1.0);
+        }
+        std::cout << "========================================================================================================\n";
+    }
+
+    // Weak scaling: n threads get n stacked copies' worth of rows
+    cv::Size baseSize = resolutions.front();
+    printSweepHeader("Weak scaling: " + std::to_string(baseSize.width) + "x" + std::to_string(baseSize.height) + 
+                     " per thread");
+    BenchmarkResult base = {0, 0, 0, 0};
+    for (int n : threadCounts) {
+        cv::Mat img = makeSyntheticImage(baseSize.height * n, baseSize.width, noiseSigma, edgeDensity, 1);
+        BenchmarkResult r = timeStagesInMemory(img, ws, n);
+        if (n == 1) base = r;
+        std::string label = std::to_string(img.cols) + "x" + std::to_string(img.rows);
+        printSweepRow(label, n, img.total() / 1e6, r, base, n);
+    }
+    std::cout << "========================================================================================================\n";
+    setNumThreads(1);
+}
+
+// ============================================================================
+// FLAT-REGION TILE SKIPPING
+// ============================================================================
+
+void printTable9(const std::string& imagePath) {
+    struct Input {
+        std::string label;
+        cv::Mat img;
+    };
+    std::vector<Input> inputs;
+    cv::Mat img = cv::imread(imagePath);
+    if (!img.empty()) inputs.push_back({"input image", img});
+    // Mostly flat frames: few shapes on a uniform background
+    inputs.push_back({"1080p d=0.02", makeSyntheticImage(1080, 1920, 0.0, 0.02, 1)});
+    inputs.push_back({"1080p d=0.1", makeSyntheticImage(1080, 1920, 0.0, 0.1, 1)});
+    inputs.push_back({"1080p d=0.1 s=2", makeSyntheticImage(1080, 1920, 2.0, 0.1, 1)});
+    inputs.push_back({"1080p d=1", makeSyntheticImage(1080, 1920, 0.0, 1.0, 1)});
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 9: Flat-Region Tile Skipping (cannyFilter only, " << CANNY_TILE << "x" << CANNY_TILE 
+              << " tiles, d = shapes per 64x64 block, s = noise sigma)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(18) << "Input"
+              << std::setw(14) << "Tiles skipped"
+              << std::setw(14) << "Dense 1T (ms)"
+              << std::setw(13) << "Skip 1T (ms)"
+              << std::setw(10) << "Speedup"
+              << std::setw(14) << ("Dense " + std::to_string(MAX_THREADS) + "T")
+              << std::setw(13) << ("Skip " + std::to_string(MAX_THREADS) + "T")
+              << std::setw(11) << "Identical" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    for (Input& input : inputs) {
+        int sizeRows = 0, sizeCols = 0;
+        std::vector<int> pixelsGray = grayPixelsOf(input.img, sizeRows, sizeCols);
+
+        double times[2][2];
+        std::vector<int> edges[2];
+        TileStats stats = {0, 0};
+        SparsityMode modes[] = {SPARSITY_DENSE, SPARSITY_SKIP_FLAT};
+        for (int m = 0; m < 2; m++) {
+            setSparsityMode(modes[m]);
+            times[m][0] = timeCannyFilter(pixelsGray, sizeRows, sizeCols, 1);
+            times[m][1] = timeCannyFilter(pixelsGray, sizeRows, sizeCols, MAX_THREADS);
+            // NMS bands race at the seams with several threads, compare single-threaded
+            setNumThreads(1);
+            edges[m] = cannyFilter_parallel(pixelsGray, sizeRows, sizeCols, 1, 0.03, 0.1);
+            if (modes[m] == SPARSITY_SKIP_FLAT) stats = getLastTileStats();
+        }
+        setSparsityMode(SPARSITY_DENSE);
+
+        std::ostringstream skipped;
+        skipped << std::fixed << std::setprecision(1) << 100.0 * stats.skippedTiles / stats.numTiles << "%";
+        std::cout << std::setw(18) << input.label
+                  << std::setw(14) << skipped.str()
+                  << std::setw(14) << std::fixed << std::setprecision(2) << times[0][0]
+                  << std::setw(13) << std::fixed << std::setprecision(2) << times[1][0]
+                  << std::setw(10) << std::fixed << std::setprecision(2) << times[0][0] / times[1][0]
+                  << std::setw(14) << std::fixed << std::setprecision(2) << times[0][1]
+                  << std::setw(13) << std::fixed << std::setprecision(2) << times[1][1]
+                  << std::setw(11) << (edges[0] == edges[1] ? "yes" : "NO") << "\n";
+    }
+    std::cout << "========================================================================================================\n";
+}
+
+// ============================================================================
+// LATENCY BUDGET
+// ============================================================================
+
+void printTable10(const std::string& imagePath) {
+    struct Input {
+        std::string label;
+        cv::Mat img;
+    };
+    std::vector<Input> inputs;
+    cv::Mat img = cv::imread(imagePath);
+    if (!img.empty()) inputs.push_back({"input image", img});
+    inputs.push_back({"1080p s=10", makeSyntheticImage(1080, 1920, 10.0, 0.25, 1)});
+
+    const double fractions[] = {2.0, 1.0, 0.75, 0.5, 0.25, 0.1, 0.02};
+    const int frames = 20;
+    setNumThreads(MAX_THREADS);
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 10: Latency Budget (" << MAX_THREADS << " threads, " << frames
+              << " frames per budget, budget as a fraction of the full-quality time)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(14) << "Input"
+              << std::setw(9) << "Budget"
+              << std::setw(14) << "Budget (ms)"
+              << std::setw(12) << "Hit rate"
+              << std::setw(12) << "p95 (ms)"
+              << std::setw(12) << "Level"
+              << std::setw(11) << "Degraded"
+              << std::setw(11) << "Hyst. cut"
+              << std::setw(12) << "Empty maps" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    for (Input& input : inputs) {
+        CannyWorkspace ws;
+        BudgetPlanner planner;
+        calibrateBudgetPlanner(input.img, ws, planner, 0.03, 0.1);
+
+        // Full-quality time: median of unbounded frames
+        std::vector<double> fullTimes;
+        for (int f = 0; f < 5; f++) {
+            BudgetPlanner fullOnly;
+            fullTimes.push_back(cannyEdgeDetectionBudget_parallel(input.img, ws, fullOnly, 1e9, 0.03, 0.1).elapsedMs);
+        }
+        std::sort(fullTimes.begin(), fullTimes.end());
+        double fullMs = fullTimes[fullTimes.size() / 2];
+
+        for (double fraction : fractions) {
+            double budgetMs = fullMs * fraction;
+            std::vector<double> elapsed;
+            int met = 0;
+            int degraded = 0;
+            int cut = 0;
+            int empty = 0;
+            int levelCount[NUM_BUDGET_LEVELS] = {};
+            for (int f = 0; f < frames; f++) {
+                BudgetResult result = cannyEdgeDetectionBudget_parallel(input.img, ws, planner, budgetMs, 0.03, 0.1);
+                elapsed.push_back(result.elapsedMs);
+                if (result.deadlineMet) met++;
+                if (result.degraded != DEGRADED_NONE) degraded++;
+                if (result.degraded & DEGRADED_HYSTERESIS) cut++;
+                // A cut frame still keeps its strong edges
+                if (std::count(ws.pixelsCanny.begin(), ws.pixelsCanny.end(), 0) == (long)ws.pixelsCanny.size()) {
+                    empty++;
+                }
+                levelCount[result.level]++;
+            }
+            std::sort(elapsed.begin(), elapsed.end());
+            double p95 = elapsed[std::min(frames - 1, (int)(0.95 * frames))];
+            int level = (int)(std::max_element(levelCount, levelCount + NUM_BUDGET_LEVELS) - levelCount);
+
+            std::ostringstream label, hit, deg, hyst;
+            label << fraction << "x";
+            hit << std::fixed << std::setprecision(0) << 100.0 * met / frames << "%";
+            deg << std::fixed << std::setprecision(0) << 100.0 * degraded / frames << "%";
+            hyst << std::fixed << std::setprecision(0) << 100.0 * cut / frames << "%";
+            std::cout << std::setw(14) << input.label
+                      << std::setw(9) << label.str()
+                      << std::setw(14) << std::fixed << std::setprecision(2) << budgetMs
+                      << std::setw(12) << hit.str()
+                      << std::setw(12) << std::fixed << std::setprecision(2) << p95
+                      << std::setw(12) << budgetLevelName((BudgetLevel)level)
+                      << std::setw(11) << deg.str()
+                      << std::setw(11) << hyst.str()
+                      << std::setw(12) << empty << "\n";
+        }
+    }
+    std::cout << "========================================================================================================\n";
+}
+
+// ============================================================================
+// INCREMENTAL FRAME-DELTA
+// ============================================================================
+
+// Next frame of a static-camera sequence: a rectangle of random color inside
+// each of round(ratio * numTiles) random tiles
+void changeTiles(cv::Mat& frame, double ratio, std::mt19937& rng) {
+    int tileRows = (frame.rows + CANNY_TILE - 1) / CANNY_TILE;
+    int tileCols = (frame.cols + CANNY_TILE - 1) / CANNY_TILE;
+    int numChanged = (int)(ratio * tileRows * tileCols + 0.5);
+    std::uniform_int_distribution<int> color(0, 255);
+    std::uniform_int_distribution<int> offset(0, CANNY_TILE / 2 - 1);
+    for (int n = 0; n < numChanged; n++) {
+        int tr = rng() % tileRows;
+        int tc = rng() % tileCols;
+        cv::Point p(tc * CANNY_TILE + offset(rng), tr * CANNY_TILE + offset(rng));
+        cv::Point q(p.x + CANNY_TILE / 2 - 1, p.y + CANNY_TILE / 2 - 1);
+        cv::rectangle(frame, p, q, cv::Scalar(color(rng), color(rng), color(rng)), -1);
+    }
+}
+
+void printTable11() {
+    const double ratios[] = {0.0, 0.01, 0.02, 0.05, 0.1, 0.25, 0.5};
+    const int frames = 10;
+    cv::Mat base = makeSyntheticImage(1080, 1920, 0.0, 0.25, 1);
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << "Table 11: Incremental Frame-Delta (1080p static camera, " << MAX_THREADS << " threads, " << frames
+              << " frames per ratio, " << CANNY_TILE << "x" << CANNY_TILE << " tiles)\n";
+    std::cout << "========================================================================================================\n";
+    std::cout << std::setw(14) << "Change ratio"
+              << std::setw(16) << "Changed tiles"
+              << std::setw(12) << "Full (ms)"
+              << std::setw(14) << "Incr. (ms)"
+              << std::setw(10) << "Speedup"
+              << std::setw(18) << "Rethresholded"
+              << std::setw(11) << "Identical" << "\n";
+    std::cout << "--------------------------------------------------------------------------------------------------------\n";
+
+    for (double ratio : ratios) {
+        std::mt19937 rng(7);
+        cv::Mat frame = base.clone();
+        CannyWorkspace ws;
+        CannyWorkspace reference;
+        IncrementalState state;
+        setNumThreads(MAX_THREADS);
+        cannyEdgeDetectionIncremental_parallel(frame, state, 0.03, 0.1);
+
+        double fullTime = 0;
+        double incrementalTime = 0;
+        int changedTiles = 0;
+        int rethresholded = 0;
+        bool identical = true;
+        IncrementalStats stats;
+        for (int f = 0; f < frames; f++) {
+            changeTiles(frame, ratio, rng);
+            setNumThreads(MAX_THREADS);
+            double start = getCurrentTimeMs();
+            cannyEdgeDetection_parallel(frame, ws, 0.03, 0.1);
+            double fullDone = getCurrentTimeMs();
+            cannyEdgeDetectionIncremental_parallel(frame, state, 0.03, 0.1, &stats);
+            double incrementalDone = getCurrentTimeMs();
+            fullTime += (fullDone - start) / frames;
+            incrementalTime += (incrementalDone - fullDone) / frames;
+            changedTiles += stats.changedTiles;
+            if (stats.rethresholded) rethresholded++;
+
+            // The incremental result matches the single-threaded pipeline
+            setNumThreads(1);
+            cannyEdgeDetection_parallel(frame, reference, 0.03, 0.1);
+            identical = identical && reference.pixelsCanny == state.pixelsCanny;
+        }
+
+        std::ostringstream tiles, reth;
+        tiles << std::fixed << std::setprecision(1) << 100.0 * changedTiles / (frames * stats.numTiles) << "%";
+        reth << rethresholded << " / " << frames;
+        std::cout << std::setw(14) << std::fixed << std::setprecision(2) << ratio
+                  << std::setw(16) << tiles.str()
+                  << std::setw(12) << std::fixed << std::setprecision(2) << fullTime
+                  << std::setw(14) << std::fixed << std::setprecision(2) << incrementalTime
+                  << std::setw(10) << std::fixed << std::setprecision(2) << fullTime / incrementalTime
+                  << std::setw(18) << reth.str()
+                  << std::setw(11) << (identical ? "yes" : "NO") << "\n";
+    }
+    std::cout << "========================================================================================================\n";
+}
+
+// "640x480,1920x1080" -> sizes; invalid entries are skipped
+std::vector<cv::Size> parseResolutions(const std::string& list) {
+    std::vector<cv::Size> sizes;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int width = 0;
+        int height = 0;
+        if (sscanf(item.c_str(), "%dx%d", &width, &height) == 2 && width >= 3 && height >= 3) {
+            sizes.push_back(cv::Size(width, height));
+        }
+    }
+    return sizes;
+}
+
 int main(int argc, char* argv[]) {
     std::string imagePath = "../images/Sukuna.jpg";
     
+    // ./benchmark sweep [WxH,WxH,...] [noise_sigma] [edge_density] [max_threads]
+    if (argc > 1 && std::string(argv[1]) == "sweep") {
+        std::vector<cv::Size> resolutions = parseResolutions(
+            argc > 2 ? argv[2] : "640x480,1280x720,1920x1080,3840x2160,7680x4320");
+        double noiseSigma = argc > 3 ? std::atof(argv[3]) : 10.0;
+        double edgeDensity = argc > 4 ? std::atof(argv[4]) : 0.25;
+        int maxThreads = argc > 5 ? std::atoi(argv[5]) : (int)std::thread::hardware_concurrency();
+        maxThreads = std::max(1, std::min(maxThreads, 16));
+        if (resolutions.empty()) {
+            std::cerr << "Error: no valid resolutions (expected e.g. 640x480,1920x1080)\n";
+            return 1;
+        }
+        runScalingSweep(resolutions, noiseSigma, edgeDensity, maxThreads);
+        return 0;
+    }
+    
     if (argc > 1) {
         imagePath = argv[1];
     }
@@ -228,6 +1031,38 @@ int main(int argc, char* argv[]) {
     std::cout << "\nRunning Table 3 benchmarks...\n";
     printTable3();
     
+    // Table 4: Batch scheduling strategies
+    std::cout << "\nRunning Table 4 benchmarks...\n";
+    printTable4(imagePath);
+    
+    // Table 5: Precision modes
+    std::cout << "\nRunning Table 5 benchmarks...\n";
+    printTable5(imagePath);
+    
+    // Table 6: Luma-first pipeline
+    std::cout << "\nRunning Table 6 benchmarks...\n";
+    printTable6(imagePath);
+    
+    // Table 7: Parallel backends
+    std::cout << "\nRunning Table 7 benchmarks...\n";
+    printTable7(imagePath);
+    
+    // Table 8: Memory plans
+    std::cout << "\nRunning Table 8 benchmarks...\n";
+    printTable8(imagePath);
+    
+    // Table 9: Flat-region tile skipping
+    std::cout << "\nRunning Table 9 benchmarks...\n";
+    printTable9(imagePath);
+    
+    // Table 10: Latency budget
+    std::cout << "\nRunning Table 10 benchmarks...\n";
+    printTable10(imagePath);
+    
+    // Table 11: Incremental frame-delta
+    std::cout << "\nRunning Table 11 benchmarks...\n";
+    printTable11();
+    
     std::cout << "\nBenchmark complete!\n";
     
     return 0;
@@ -58,9 +58,9 @@ std::vector<int> imgToArray(cv::Mat img, uint8_t* pixelPtr, int sizeRows, int si
     for (int i = 0; i < sizeRows; i++) {
         for (int j = 0; j < sizeCols; j++) {
             for (int k = 0; k < sizeDepth; k++) {
-                // converting BGR to RGB colors
+                // converting BGR to RGB colors (gray has one channel)
                 pixels[i * sizeCols * sizeDepth + j * sizeDepth + k] =
-                    (int)pixelPtr[i * sizeCols * sizeDepth + j * sizeDepth + 2 - k];
+                    (int)pixelPtr[i * sizeCols * sizeDepth + j * sizeDepth + (sizeDepth - 1 - k)];
             }
         }
     }
@@ -0,0 +1,287 @@
+#include "canny_backend.h"
+#include "canny_parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+
+#ifdef CANNY_WITH_OPENMP
+#include <omp.h>
+#endif
+
+#ifdef CANNY_WITH_STD_EXECUTION
+#include <execution>
+#endif
+
+#ifndef CANNY_DEFAULT_BACKEND
+#define CANNY_DEFAULT_BACKEND BACKEND_PTHREAD
+#endif
+
+// ============================================================================
+// BACKEND SELECTION
+// ============================================================================
+
+static ParallelBackend initialBackend();
+static ParallelBackend g_backend = initialBackend();
+
+bool isParallelBackendAvailable(ParallelBackend backend) {
+    switch (backend) {
+    case BACKEND_PTHREAD:
+    case BACKEND_SERIAL:
+        return true;
+    case BACKEND_OPENMP:
+#ifdef CANNY_WITH_OPENMP
+        return true;
+#else
+        return false;
+#endif
+    case BACKEND_STD_PAR:
+#ifdef CANNY_WITH_STD_EXECUTION
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool setParallelBackend(ParallelBackend backend) {
+    if (!isParallelBackendAvailable(backend)) return false;
+    g_backend = backend;
+    return true;
+}
+
+ParallelBackend getParallelBackend() {
+    return g_backend;
+}
+
+const char* parallelBackendName(ParallelBackend backend) {
+    switch (backend) {
+    case BACKEND_PTHREAD: return "pthread";
+    case BACKEND_OPENMP: return "openmp";
+    case BACKEND_STD_PAR: return "stdpar";
+    case BACKEND_SERIAL: return "serial";
+    }
+    return "unknown";
+}
+
+bool parseParallelBackend(const std::string& name, ParallelBackend& backend) {
+    ParallelBackend all[] = {BACKEND_PTHREAD, BACKEND_OPENMP, BACKEND_STD_PAR, BACKEND_SERIAL};
+    for (ParallelBackend b : all) {
+        if (name == parallelBackendName(b)) {
+            backend = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+static ParallelBackend initialBackend() {
+    ParallelBackend backend = CANNY_DEFAULT_BACKEND;
+    const char* env = getenv("CANNY_BACKEND");
+    if (env) {
+        ParallelBackend requested;
+        if (!parseParallelBackend(env, requested)) {
+            std::cerr << "Warning: unknown CANNY_BACKEND " << env << ", using " << parallelBackendName(backend) << "\n";
+        } else if (!isParallelBackendAvailable(requested)) {
+            std::cerr << "Warning: backend " << env << " was not compiled in, using " << parallelBackendName(backend) << "\n";
+        } else {
+            backend = requested;
+        }
+    }
+    return backend;
+}
+
+// ============================================================================
+// WORKER POOL
+// ============================================================================
+
+struct PoolTask {
+    void* (*worker)(void*);
+    void* arg;
+    int* remaining;
+};
+
+struct WorkerPool {
+    bool running = false;
+    bool stopping = false;
+    std::vector<pthread_t> threads;
+    std::deque<PoolTask> tasks;
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t taskReady = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t taskDone = PTHREAD_COND_INITIALIZER;
+};
+
+static WorkerPool g_pool;
+
+static void* poolWorker(void*) {
+    pthread_mutex_lock(&g_pool.mutex);
+    while (true) {
+        while (g_pool.tasks.empty() && !g_pool.stopping) {
+            pthread_cond_wait(&g_pool.taskReady, &g_pool.mutex);
+        }
+        if (g_pool.tasks.empty()) break;
+        PoolTask task = g_pool.tasks.front();
+        g_pool.tasks.pop_front();
+        pthread_mutex_unlock(&g_pool.mutex);
+
+        task.worker(task.arg);
+
+        pthread_mutex_lock(&g_pool.mutex);
+        if (--(*task.remaining) == 0) {
+            pthread_cond_broadcast(&g_pool.taskDone);
+        }
+    }
+    pthread_mutex_unlock(&g_pool.mutex);
+    return nullptr;
+}
+
+void startWorkerPool(int numWorkers) {
+    stopWorkerPool();
+    g_pool.stopping = false;
+    g_pool.threads.resize(std::max(1, numWorkers));
+    for (pthread_t& thread : g_pool.threads) {
+        pthread_create(&thread, nullptr, poolWorker, nullptr);
+    }
+    g_pool.running = true;
+}
+
+void stopWorkerPool() {
+    if (!g_pool.running) return;
+    pthread_mutex_lock(&g_pool.mutex);
+    g_pool.stopping = true;
+    pthread_cond_broadcast(&g_pool.taskReady);
+    pthread_mutex_unlock(&g_pool.mutex);
+    for (pthread_t& thread : g_pool.threads) {
+        pthread_join(thread, nullptr);
+    }
+    g_pool.threads.clear();
+    g_pool.running = false;
+}
+
+bool isWorkerPoolRunning() {
+    return g_pool.running;
+}
+
+// ============================================================================
+// BACKENDS
+// ============================================================================
+
+// Bands shared by threads that each take the next unprocessed one
+struct BandQueue {
+    void* (*worker)(void*);
+    ThreadData* threadData;
+    int numBands;
+    std::atomic<int> next;
+};
+
+static void* bandQueueWorker(void* arg) {
+    BandQueue* queue = (BandQueue*)arg;
+    int b;
+    while ((b = queue->next++) < queue->numBands) {
+        queue->worker(&queue->threadData[b]);
+    }
+    return nullptr;
+}
+
+// pthread backend: the pool when it is running, else one pthread per band,
+// or numThreads pthreads sharing the bands when there are more bands. The
+// pool gets one task per thread, each taking bands from a shared queue, so
+// at most numThreads pool workers run the stage.
+static void runPthreads(void* (*worker)(void*), ThreadData* threadData, int numBands, int numThreads) {
+    if (g_pool.running) {
+        BandQueue queue;
+        queue.worker = worker;
+        queue.threadData = threadData;
+        queue.numBands = numBands;
+        queue.next = 0;
+        int numTasks = std::min(numThreads, (int)g_pool.threads.size());
+        int remaining = numTasks;
+        pthread_mutex_lock(&g_pool.mutex);
+        for (int t = 0; t < numTasks; t++) {
+            g_pool.tasks.push_back({bandQueueWorker, &queue, &remaining});
+        }
+        pthread_cond_broadcast(&g_pool.taskReady);
+        while (remaining > 0) {
+            pthread_cond_wait(&g_pool.taskDone, &g_pool.mutex);
+        }
+        pthread_mutex_unlock(&g_pool.mutex);
+        return;
+    }
+
+    if (numBands == numThreads) {
+        pthread_t threads[numThreads];
+        for (int t = 0; t < numThreads; t++) {
+            pthread_create(&threads[t], nullptr, worker, &threadData[t]);
+        }
+        for (int t = 0; t < numThreads; t++) {
+            pthread_join(threads[t], nullptr);
+        }
+        return;
+    }
+
+    BandQueue queue;
+    queue.worker = worker;
+    queue.threadData = threadData;
+    queue.numBands = numBands;
+    queue.next = 0;
+    pthread_t threads[numThreads];
+    for (int t = 0; t < numThreads; t++) {
+        pthread_create(&threads[t], nullptr, bandQueueWorker, &queue);
+    }
+    for (int t = 0; t < numThreads; t++) {
+        pthread_join(threads[t], nullptr);
+    }
+}
+
+void runThreads(void* (*worker)(void*), ThreadData* threadData, int numBands, int numThreads) {
+    numThreads = std::max(1, std::min(numThreads, numBands));
+
+    // A single thread always runs the bands on the calling thread
+    if (numThreads == 1) {
+        for (int b = 0; b < numBands; b++) {
+            worker(&threadData[b]);
+        }
+        return;
+    }
+
+    switch (g_backend) {
+    case BACKEND_PTHREAD:
+        runPthreads(worker, threadData, numBands, numThreads);
+        return;
+    case BACKEND_OPENMP:
+#ifdef CANNY_WITH_OPENMP
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1)
+        for (int b = 0; b < numBands; b++) {
+            worker(&threadData[b]);
+        }
+        return;
+#else
+        break;
+#endif
+    case BACKEND_STD_PAR:
+#ifdef CANNY_WITH_STD_EXECUTION
+    {
+        // One element per thread, each taking bands from a shared queue, so
+        // no more than numThreads run at once whatever the library's pool size
+        BandQueue queue;
+        queue.worker = worker;
+        queue.threadData = threadData;
+        queue.numBands = numBands;
+        queue.next = 0;
+        std::vector<BandQueue*> lanes(numThreads, &queue);
+        std::for_each(std::execution::par, lanes.begin(), lanes.end(),
+                      [](BandQueue* lane) { bandQueueWorker(lane); });
+        return;
+    }
+#else
+        break;
+#endif
+    case BACKEND_SERIAL:
+        break;
+    }
+
+    for (int b = 0; b < numBands; b++) {
+        worker(&threadData[b]);
+    }
+}
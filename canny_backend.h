@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+// Parallel backends for the row-band loops in canny_parallel.cpp. Every
+// parallel stage splits the image into row bands (one per thread unless a
+// chunk size is configured) and hands them to runThreads(), which executes
+// them on the selected backend with at most the requested number of threads
+// busy at once (the worker pool and the std::execution library may own more).
+//
+// The OpenMP and std::execution backends are only available when built with
+// the CANNY_WITH_OPENMP / CANNY_WITH_STD_EXECUTION CMake options. The startup
+// backend is CANNY_DEFAULT_BACKEND, overridable with the CANNY_BACKEND
+// environment variable (pthread, openmp, stdpar or serial).
+enum ParallelBackend {
+    BACKEND_PTHREAD,  // one pthread per band, or the worker pool when running
+    BACKEND_OPENMP,   // omp parallel for over the bands
+    BACKEND_STD_PAR,  // std::for_each(std::execution::par) over the bands
+    BACKEND_SERIAL,   // bands run one after another on the calling thread
+};
+
+// Returns false (and keeps the current backend) if it was not compiled in
+bool setParallelBackend(ParallelBackend backend);
+ParallelBackend getParallelBackend();
+bool isParallelBackendAvailable(ParallelBackend backend);
+const char* parallelBackendName(ParallelBackend backend);
+bool parseParallelBackend(const std::string& name, ParallelBackend& backend);
+
+// Persistent worker pool for the pthread backend. While it is running the
+// parallel functions hand their row bands to these threads instead of
+// creating new ones per call.
+void startWorkerPool(int numWorkers);
+void stopWorkerPool();
+bool isWorkerPoolRunning();
+
+// Run worker(&threadData[b]) for every band b in [0, numBands) with at most
+// numThreads bands in flight, and wait for all of them
+struct ThreadData;
+void runThreads(void* (*worker)(void*), ThreadData* threadData, int numBands, int numThreads);
@@ -0,0 +1,109 @@
+#include "canny_batch.h"
+#include "canny_parallel.h"
+#include <algorithm>
+
+struct BatchThreadData {
+    const std::vector<cv::Mat>* images;
+    std::vector<std::vector<int>>* edges;
+    const std::vector<int>* order;
+    int* next;
+    pthread_mutex_t* mutex;
+    double lowerThreshold;
+    double higherThreshold;
+};
+
+// Image-level worker: pulls the next image off the shared list and runs the
+// whole pipeline on it with a single thread.
+void* batchImageWorker(void* arg) {
+    BatchThreadData* data = (BatchThreadData*)arg;
+    setThreadLocalNumThreads(1);
+    CannyWorkspace ws;
+
+    while (true) {
+        pthread_mutex_lock(data->mutex);
+        int n = (*data->next)++;
+        pthread_mutex_unlock(data->mutex);
+        if (n >= (int)data->order->size()) break;
+
+        int idx = (*data->order)[n];
+        cannyEdgeDetection_parallel((*data->images)[idx], ws, data->lowerThreshold, data->higherThreshold);
+        (*data->edges)[idx] = ws.pixelsCanny;
+    }
+
+    setThreadLocalNumThreads(0);
+    return nullptr;
+}
+
+void cannyBatch_parallel(const std::vector<cv::Mat>& images, std::vector<std::vector<int>>& edges, 
+                         double lowerThreshold, double higherThreshold, 
+                         BatchStrategy strategy, int splitThresholdPixels, BatchStats* stats) {
+    double start = getCurrentTimeMs();
+    int numThreads = getNumThreads();
+    edges.resize(images.size());
+
+    std::vector<int> single;
+    std::vector<int> split;
+    double megapixels = 0;
+    for (int i = 0; i < (int)images.size(); i++) {
+        long long numPixels = (long long)images[i].rows * images[i].cols;
+        megapixels += numPixels / 1e6;
+        bool splitImage = strategy == BATCH_INTRA_IMAGE || 
+                          (strategy == BATCH_HYBRID && numPixels >= splitThresholdPixels);
+        if (splitImage && numThreads > 1) {
+            split.push_back(i);
+        } else {
+            single.push_back(i);
+        }
+    }
+
+    // Small images: largest first so the tail of the batch stays balanced
+    std::sort(single.begin(), single.end(), [&](int a, int b) {
+        return (long long)images[a].rows * images[a].cols > (long long)images[b].rows * images[b].cols;
+    });
+
+    if (!single.empty()) {
+        int workers = std::min(numThreads, (int)single.size());
+        int next = 0;
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        pthread_t threads[workers];
+        BatchThreadData threadData[workers];
+
+        for (int t = 0; t < workers; t++) {
+            threadData[t].images = &images;
+            threadData[t].edges = &edges;
+            threadData[t].order = &single;
+            threadData[t].next = &next;
+            threadData[t].mutex = &mutex;
+            threadData[t].lowerThreshold = lowerThreshold;
+            threadData[t].higherThreshold = higherThreshold;
+            pthread_create(&threads[t], nullptr, batchImageWorker, &threadData[t]);
+        }
+        for (int t = 0; t < workers; t++) {
+            pthread_join(threads[t], nullptr);
+        }
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // Large images: one at a time, each split across all threads
+    CannyWorkspace ws;
+    for (int idx : split) {
+        cannyEdgeDetection_parallel(images[idx], ws, lowerThreshold, higherThreshold);
+        edges[idx] = ws.pixelsCanny;
+    }
+
+    if (stats) {
+        stats->totalTime = getCurrentTimeMs() - start;
+        stats->megapixels = megapixels;
+        stats->imagesSingle = (int)single.size();
+        stats->imagesSplit = (int)split.size();
+    }
+}
+
+const char* batchStrategyName(BatchStrategy strategy) {
+    switch (strategy) {
+    case BATCH_HYBRID: return "hybrid";
+    case BATCH_IMAGE_LEVEL: return "image-level";
+    case BATCH_INTRA_IMAGE: return "intra-image";
+    }
+    return "unknown";
+}
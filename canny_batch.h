@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/highgui.hpp>
+
+// Batch scheduling for many images of mixed sizes.
+//
+// Row-band splitting only pays off for large frames; for thumbnails the
+// per-stage synchronization dominates. The hybrid strategy runs every image
+// below splitThresholdPixels single-threaded, several at once (one image per
+// thread), and splits the remaining large images across all threads.
+
+enum BatchStrategy {
+    BATCH_HYBRID,       // choose per image by pixel count
+    BATCH_IMAGE_LEVEL,  // every image single-threaded, images in parallel
+    BATCH_INTRA_IMAGE,  // every image split across all threads, one at a time
+};
+
+// Images with at least this many pixels are split across threads by default
+const int DEFAULT_SPLIT_PIXELS = 512 * 512;
+
+struct BatchStats {
+    double totalTime;      // wall time of the whole batch (ms)
+    double megapixels;     // total input size
+    int imagesSingle;      // images run single-threaded
+    int imagesSplit;       // images split across threads
+};
+
+// Run the parallel pipeline on every image with getNumThreads() threads in
+// total. edges[i] receives the edge map of images[i] (rows * cols, 0..255).
+void cannyBatch_parallel(const std::vector<cv::Mat>& images, std::vector<std::vector<int>>& edges, 
+                         double lowerThreshold, double higherThreshold, 
+                         BatchStrategy strategy = BATCH_HYBRID, int splitThresholdPixels = DEFAULT_SPLIT_PIXELS, 
+                         BatchStats* stats = nullptr);
+
+const char* batchStrategyName(BatchStrategy strategy);
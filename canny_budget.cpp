@@ -0,0 +1,216 @@
+#include "canny_budget.h"
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+struct LevelPlan {
+    PipelineMode pipeline;
+    CannyPrecision precision;
+    int scale;  // downscale factor
+};
+
+static const LevelPlan LEVEL_PLANS[NUM_BUDGET_LEVELS] = {
+    {PIPELINE_CHANNEL_FIRST, PRECISION_EXACT, 1},
+    {PIPELINE_LUMA_AVERAGE, PRECISION_EXACT, 1},
+    {PIPELINE_LUMA_AVERAGE, PRECISION_FAST_L1, 1},
+    {PIPELINE_LUMA_AVERAGE, PRECISION_FAST_L1, 2},
+    {PIPELINE_LUMA_AVERAGE, PRECISION_FAST_L1, 4},
+};
+
+const char* budgetLevelName(BudgetLevel level) {
+    switch (level) {
+    case BUDGET_FULL: return "full";
+    case BUDGET_LUMA: return "luma";
+    case BUDGET_LUMA_FAST: return "luma-fast";
+    case BUDGET_HALF: return "half";
+    case BUDGET_QUARTER: return "quarter";
+    default: break;
+    }
+    return "unknown";
+}
+
+std::string budgetDegradationName(unsigned degraded) {
+    if (degraded == DEGRADED_NONE) return "none";
+    const char* names[] = {"pipeline", "precision", "resolution", "hysteresis"};
+    std::string out;
+    for (int b = 0; b < 4; b++) {
+        if (!(degraded & (1u << b))) continue;
+        if (!out.empty()) out += "+";
+        out += names[b];
+    }
+    return out;
+}
+
+// ============================================================================
+// PLANNING
+// ============================================================================
+
+// Measured cost, else one derived from a measured sibling, else 0
+static double stageCost(const BudgetPlanner& planner, BudgetCost cost) {
+    const double* c = planner.msPerMegapixel;
+    if (c[cost] > 0) return c[cost];
+    switch (cost) {
+    case COST_BLUR_CHANNEL: return c[COST_BLUR_LUMA] * 3;
+    case COST_BLUR_LUMA: return c[COST_BLUR_CHANNEL] / 3;
+    case COST_GRAY: return stageCost(planner, COST_BLUR_CHANNEL) / 10;
+    case COST_CANNY_EXACT: return c[COST_CANNY_FAST] * 2;
+    case COST_CANNY_FAST: return c[COST_CANNY_EXACT];
+    case COST_RESAMPLE: return stageCost(planner, COST_GRAY);
+    default: break;
+    }
+    return 0;
+}
+
+double predictBudgetLevel(const BudgetPlanner& planner, BudgetLevel level, int sizeRows, int sizeCols) {
+    const LevelPlan& plan = LEVEL_PLANS[level];
+    double megapixels = (double)sizeRows * sizeCols / 1e6;
+    double scaled = megapixels / (plan.scale * plan.scale);
+
+    std::vector<std::pair<BudgetCost, double>> parts;
+    if (plan.pipeline == PIPELINE_CHANNEL_FIRST) {
+        parts.push_back({COST_BLUR_CHANNEL, scaled});
+        parts.push_back({COST_GRAY, scaled});
+    } else {
+        parts.push_back({COST_BLUR_LUMA, scaled});
+    }
+    parts.push_back({plan.precision == PRECISION_EXACT ? COST_CANNY_EXACT : COST_CANNY_FAST, scaled});
+    if (plan.scale > 1) parts.push_back({COST_RESAMPLE, megapixels});
+
+    double total = 0;
+    for (const auto& part : parts) {
+        double cost = stageCost(planner, part.first);
+        if (cost <= 0) return -1;
+        total += cost * part.second;
+    }
+    return total;
+}
+
+BudgetLevel chooseBudgetLevel(const BudgetPlanner& planner, double budgetMs, int sizeRows, int sizeCols) {
+    bool anyKnown = false;
+    for (int l = 0; l < NUM_BUDGET_LEVELS; l++) {
+        double predicted = predictBudgetLevel(planner, (BudgetLevel)l, sizeRows, sizeCols);
+        if (predicted < 0) continue;
+        anyKnown = true;
+        if (predicted <= planner.headroom * budgetMs) return (BudgetLevel)l;
+    }
+    // Nothing measured yet: the first frame is the measurement
+    return anyKnown ? BUDGET_QUARTER : BUDGET_FULL;
+}
+
+static void recordCost(BudgetPlanner& planner, BudgetCost cost, double ms, double megapixels) {
+    if (megapixels <= 0) return;
+    double measured = std::max(ms / megapixels, 1e-6);
+    double& current = planner.msPerMegapixel[cost];
+    current = current > 0 ? current + planner.smoothing * (measured - current) : measured;
+}
+
+// ============================================================================
+// EXECUTION
+// ============================================================================
+
+static BudgetResult runLevel(const cv::Mat& img, CannyWorkspace& ws, BudgetPlanner& planner, BudgetLevel level,
+                             double startMs, double deadlineMs, double lowerThreshold, double higherThreshold) {
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+    const LevelPlan& plan = LEVEL_PLANS[level];
+    double megapixels = img.total() / 1e6;
+
+    cv::Mat small = img;
+    if (plan.scale > 1) {
+        cv::Size size(std::max(3, img.cols / plan.scale), std::max(3, img.rows / plan.scale));
+        cv::resize(img, small, size, 0, 0, cv::INTER_AREA);
+    }
+    double resized = getCurrentTimeMs();
+    int sizeRows = small.rows;
+    int sizeCols = small.cols;
+    int sizeDepth = small.channels();
+    double scaledMegapixels = small.total() / 1e6;
+
+    if (plan.pipeline == PIPELINE_CHANNEL_FIRST) {
+        // Same conversion as imgToArray, but into the reused buffer
+        const uint8_t* pixelPtr = (const uint8_t*)small.data;
+        ws.pixels.resize(sizeRows * sizeCols * sizeDepth);
+        for (int i = 0; i < sizeRows * sizeCols; i++) {
+            for (int k = 0; k < sizeDepth; k++) {
+                ws.pixels[i * sizeDepth + k] = (int)pixelPtr[i * sizeDepth + sizeDepth - 1 - k];
+            }
+        }
+        gaussianBlur_parallel(ws.pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, ws.pixelsBlur);
+        double blurred = getCurrentTimeMs();
+        rgbToGrayscale_parallel(ws.pixelsBlur, sizeRows, sizeCols, sizeDepth, ws.pixelsGray);
+        recordCost(planner, COST_BLUR_CHANNEL, blurred - resized, scaledMegapixels);
+        recordCost(planner, COST_GRAY, getCurrentTimeMs() - blurred, scaledMegapixels);
+    } else {
+        lumaBlur_parallel(small, plan.pipeline, kernel, kernelConst, ws.pixels, ws.pixelsBlur, ws.pixelsGray);
+        recordCost(planner, COST_BLUR_LUMA, getCurrentTimeMs() - resized, scaledMegapixels);
+    }
+
+    // Hysteresis stops at the frame's deadline
+    double cannyStart = getCurrentTimeMs();
+    HysteresisLimit saved = getHysteresisLimit();
+    HysteresisLimit limit = saved;
+    limit.deadlineMs = deadlineMs;
+    setHysteresisLimit(limit);
+    if (plan.precision == PRECISION_EXACT) {
+        cannyFilter_parallel(ws.pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold,
+                             ws.G, ws.theta, ws.pixelsCanny);
+    } else {
+        cannyFilterFast_parallel(ws.pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold,
+                                 plan.precision, ws.Gfast, ws.theta, ws.pixelsCanny);
+    }
+    HysteresisOutcome hysteresis = getLastHysteresisOutcome();
+    setHysteresisLimit(saved);
+    double cannyEnd = getCurrentTimeMs();
+
+    // A cut hysteresis only gives a lower bound of the stage cost
+    BudgetCost cannyCost = plan.precision == PRECISION_EXACT ? COST_CANNY_EXACT : COST_CANNY_FAST;
+    if (hysteresis == HYSTERESIS_COMPLETE ||
+        (cannyEnd - cannyStart) / scaledMegapixels > planner.msPerMegapixel[cannyCost]) {
+        recordCost(planner, cannyCost, cannyEnd - cannyStart, scaledMegapixels);
+    }
+
+    if (plan.scale > 1) {
+        // Nearest-neighbour upscale of the edge map, through the free gray buffer
+        ws.pixelsGray.resize(img.rows * img.cols);
+        for (int i = 0; i < img.rows; i++) {
+            const int* src = &ws.pixelsCanny[(size_t)(i * sizeRows / img.rows) * sizeCols];
+            int* dst = &ws.pixelsGray[(size_t)i * img.cols];
+            for (int j = 0; j < img.cols; j++) {
+                dst[j] = src[j * sizeCols / img.cols];
+            }
+        }
+        ws.pixelsCanny.swap(ws.pixelsGray);
+        recordCost(planner, COST_RESAMPLE, (resized - startMs) + (getCurrentTimeMs() - cannyEnd), megapixels);
+    }
+
+    BudgetResult result;
+    result.elapsedMs = getCurrentTimeMs() - startMs;
+    result.deadlineMet = deadlineMs <= 0 || getCurrentTimeMs() <= deadlineMs;
+    result.level = level;
+    result.degraded = DEGRADED_NONE;
+    if (plan.pipeline != PIPELINE_CHANNEL_FIRST) result.degraded |= DEGRADED_PIPELINE;
+    if (plan.precision != PRECISION_EXACT) result.degraded |= DEGRADED_PRECISION;
+    if (plan.scale > 1) result.degraded |= DEGRADED_RESOLUTION;
+    if (hysteresis != HYSTERESIS_COMPLETE) result.degraded |= DEGRADED_HYSTERESIS;
+    result.hysteresis = hysteresis;
+    return result;
+}
+
+BudgetResult cannyEdgeDetectionBudget_parallel(const cv::Mat& img, CannyWorkspace& ws, BudgetPlanner& planner,
+                                               double budgetMs, double lowerThreshold, double higherThreshold) {
+    double start = getCurrentTimeMs();
+    BudgetLevel level = chooseBudgetLevel(planner, budgetMs, img.rows, img.cols);
+    return runLevel(img, ws, planner, level, start, start + budgetMs, lowerThreshold, higherThreshold);
+}
+
+void calibrateBudgetPlanner(const cv::Mat& img, CannyWorkspace& ws, BudgetPlanner& planner,
+                            double lowerThreshold, double higherThreshold) {
+    // The first run of each level also sizes the workspace, the second is
+    // the one that mostly counts
+    for (int run = 0; run < 2; run++) {
+        for (int l = 0; l < NUM_BUDGET_LEVELS; l++) {
+            runLevel(img, ws, planner, (BudgetLevel)l, getCurrentTimeMs(), 0, lowerThreshold, higherThreshold);
+        }
+    }
+}
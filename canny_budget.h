@@ -0,0 +1,85 @@
+#pragma once
+
+#include <opencv2/highgui.hpp>
+
+#include "canny_parallel.h"
+
+// Latency-budget mode for real-time callers.
+//
+// The caller passes a time budget per frame. A planner predicts the time of
+// each quality level from the measured cost (ms per megapixel) of every stage
+// variant and runs the best level that fits; the costs are updated after
+// every frame. Hysteresis, whose time depends on the data, gets the frame's
+// deadline and is cut short if it is reached (see HysteresisLimit). The
+// result says which level ran and what was degraded.
+//
+// Until a stage variant has been measured its cost is derived from a measured
+// sibling (the luma blur at a third of the three-channel blur, the fast
+// gradient at the exact one's cost). A fresh planner runs the first frame at
+// full quality; calibrateBudgetPlanner() measures every level up front.
+
+// Quality levels, best first
+enum BudgetLevel {
+    BUDGET_FULL,           // channel-first, exact, full resolution
+    BUDGET_LUMA,           // luma-first blur, exact
+    BUDGET_LUMA_FAST,      // luma-first blur, fast-l1 gradient
+    BUDGET_HALF,           // as above at half resolution, edges upscaled
+    BUDGET_QUARTER,        // as above at quarter resolution
+    NUM_BUDGET_LEVELS,
+};
+
+// What a frame gave up, as bit flags
+enum BudgetDegradation {
+    DEGRADED_NONE = 0,
+    DEGRADED_PIPELINE = 1,       // blurred the gray image instead of B, G, R
+    DEGRADED_PRECISION = 2,      // fast-l1 gradient instead of exact
+    DEGRADED_RESOLUTION = 4,     // processed a downscaled image
+    DEGRADED_HYSTERESIS = 8,     // hysteresis cut at the deadline
+};
+
+// Stage variants with a measured cost
+enum BudgetCost {
+    COST_BLUR_CHANNEL,  // image load + three-channel blur
+    COST_BLUR_LUMA,     // fused gray conversion + one-channel blur
+    COST_GRAY,          // channel-first grayscale
+    COST_CANNY_EXACT,
+    COST_CANNY_FAST,
+    COST_RESAMPLE,      // downscale + edge map upscale, per input megapixel
+    NUM_BUDGET_COSTS,
+};
+
+struct BudgetPlanner {
+    double msPerMegapixel[NUM_BUDGET_COSTS] = {};  // 0 until measured
+    double headroom = 0.85;  // fraction of the budget a plan may fill
+    double smoothing = 0.3;  // weight of a new measurement
+};
+
+struct BudgetResult {
+    double elapsedMs;
+    bool deadlineMet;
+    BudgetLevel level;
+    unsigned degraded;       // BudgetDegradation flags
+    HysteresisOutcome hysteresis;
+};
+
+// Predicted time (ms) of a level for an image of the given size; negative if
+// a needed cost has not been measured or derived yet
+double predictBudgetLevel(const BudgetPlanner& planner, BudgetLevel level, int sizeRows, int sizeCols);
+
+// Best level predicted to fit headroom * budgetMs (the lowest if none does)
+BudgetLevel chooseBudgetLevel(const BudgetPlanner& planner, double budgetMs, int sizeRows, int sizeCols);
+
+// Run one frame within budgetMs. The edge map is left in ws.pixelsCanny at
+// the input's full size. Uses getNumThreads() threads and updates the
+// planner's costs.
+BudgetResult cannyEdgeDetectionBudget_parallel(const cv::Mat& img, CannyWorkspace& ws, BudgetPlanner& planner,
+                                               double budgetMs, double lowerThreshold, double higherThreshold);
+
+// Run every level once on img so all costs are measured
+void calibrateBudgetPlanner(const cv::Mat& img, CannyWorkspace& ws, BudgetPlanner& planner,
+                            double lowerThreshold, double higherThreshold);
+
+const char* budgetLevelName(BudgetLevel level);
+
+// "luma+precision", "none", ...
+std::string budgetDegradationName(unsigned degraded);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Wire protocol shared by canny_daemon and canny_client.
+//
+// A client connects to the daemon's Unix domain socket and sends fixed-size
+// DaemonRequest structs; the daemon answers each one with a DaemonResponse.
+// A connection may carry any number of requests.
+//
+// OP_PATH  input/output are file paths, the daemon reads and writes them.
+// OP_SHM   input is a POSIX shared memory name. The segment holds the BGR
+//          image (rows * cols * depth bytes) followed by rows * cols bytes
+//          that the daemon fills with the edge map.
+// OP_STATS the daemon returns its latency metrics in message.
+
+#define CANNY_DAEMON_MAGIC 0x43414e59u  // "CANY"
+#define CANNY_DAEMON_SOCKET "/tmp/canny.sock"
+#define CANNY_DAEMON_NAME_LEN 256
+#define CANNY_DAEMON_MESSAGE_LEN 512
+
+enum DaemonOp : uint32_t {
+    OP_PATH = 1,
+    OP_SHM = 2,
+    OP_STATS = 3,
+};
+
+struct DaemonRequest {
+    uint32_t magic;
+    uint32_t op;
+    int32_t rows;   // OP_SHM only
+    int32_t cols;   // OP_SHM only
+    int32_t depth;  // OP_SHM only
+    double lowerThreshold;
+    double higherThreshold;
+    char input[CANNY_DAEMON_NAME_LEN];
+    char output[CANNY_DAEMON_NAME_LEN];
+};
+
+struct DaemonResponse {
+    uint32_t magic;
+    int32_t status;    // 0 on success
+    double latencyMs;  // time spent in the daemon for this request
+    char message[CANNY_DAEMON_MESSAGE_LEN];
+};
+
+// Size of the shared memory segment for an OP_SHM request
+inline uint64_t daemonShmSize(int rows, int cols, int depth) {
+    return (uint64_t)rows * cols * depth + (uint64_t)rows * cols;
+}
+
+// Summarize request latencies (ms) as "n=.. mean=.. p50=.. p95=.. p99=.. max=.."
+inline std::string formatLatencies(std::vector<double> latencies) {
+    if (latencies.empty()) return "n=0";
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l : latencies) sum += l;
+    auto pct = [&](double p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+    char buf[CANNY_DAEMON_MESSAGE_LEN];
+    snprintf(buf, sizeof(buf), "n=%zu mean=%.3fms p50=%.3fms p95=%.3fms p99=%.3fms max=%.3fms",
+             latencies.size(), sum / latencies.size(), pct(0.50), pct(0.95), pct(0.99), latencies.back());
+    return buf;
+}
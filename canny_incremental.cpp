@@ -0,0 +1,506 @@
+#include "canny_incremental.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// ============================================================================
+// DIRTY REGIONS
+// ============================================================================
+
+// Calls visit(j0, j1) for the column spans [j0, j1) of row i that lie within
+// halo pixels of a changed tile
+template <typename Visit>
+static inline void forEachDirtySpan(const uint8_t* changed, int tileCols, int sizeRows, int sizeCols,
+                                    int i, int halo, Visit visit) {
+    int tileRows = (sizeRows + CANNY_TILE - 1) / CANNY_TILE;
+    int firstTileRow = std::max(0, (i - halo) / CANNY_TILE);
+    int lastTileRow = std::min(tileRows - 1, (i + halo) / CANNY_TILE);
+    int spanStart = -1;
+    int spanEnd = -1;
+    for (int tc = 0; tc < tileCols; tc++) {
+        bool dirty = false;
+        for (int tr = firstTileRow; tr <= lastTileRow && !dirty; tr++) {
+            dirty = changed[tr * tileCols + tc];
+        }
+        if (!dirty) continue;
+        int j0 = std::max(0, tc * CANNY_TILE - halo);
+        int j1 = std::min(sizeCols, (tc + 1) * CANNY_TILE + halo);
+        if (j0 <= spanEnd) {
+            spanEnd = j1;
+            continue;
+        }
+        if (spanStart >= 0) visit(spanStart, spanEnd);
+        spanStart = j0;
+        spanEnd = j1;
+    }
+    if (spanStart >= 0) visit(spanStart, spanEnd);
+}
+
+static void resetMarks(PixelMarks& marks, int sizeRows, int sizeCols) {
+    marks.marks.assign(sizeRows * sizeCols, 0);
+    marks.first.assign(sizeRows, INT_MAX);
+    marks.last.assign(sizeRows, -1);
+}
+
+// Only interior pixels go through NMS and hysteresis
+static inline void mark(PixelMarks& marks, int sizeRows, int sizeCols, int i, int j) {
+    if (i < 1 || i >= sizeRows - 1 || j < 1 || j >= sizeCols - 1) return;
+    marks.marks[i * sizeCols + j] = 1;
+    marks.first[i] = std::min(marks.first[i], j);
+    marks.last[i] = std::max(marks.last[i], j);
+}
+
+static inline void markAround(PixelMarks& marks, int sizeRows, int sizeCols, int i, int j) {
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            mark(marks, sizeRows, sizeCols, i + x, j + y);
+        }
+    }
+}
+
+// The pixels after (i, j) in raster order that read its value
+static inline void markLater(PixelMarks& marks, int sizeRows, int sizeCols, int i, int j) {
+    mark(marks, sizeRows, sizeCols, i, j + 1);
+    mark(marks, sizeRows, sizeCols, i + 1, j - 1);
+    mark(marks, sizeRows, sizeCols, i + 1, j);
+    mark(marks, sizeRows, sizeCols, i + 1, j + 1);
+}
+
+// Visits the marked pixels in raster order and clears the marks; visit may
+// mark pixels later in raster order. Returns the number of pixels visited.
+template <typename Visit>
+static int sweepMarks(PixelMarks& marks, int sizeRows, int sizeCols, Visit visit) {
+    int visited = 0;
+    for (int i = 1; i < sizeRows - 1; i++) {
+        // last can grow while the row is swept
+        for (int j = marks.first[i]; j <= marks.last[i]; j++) {
+            uint8_t& m = marks.marks[i * sizeCols + j];
+            if (!m) continue;
+            m = 0;
+            visited++;
+            visit(i, j);
+        }
+        marks.first[i] = INT_MAX;
+        marks.last[i] = -1;
+    }
+    return visited;
+}
+
+// ============================================================================
+// BLUR, GRAY AND GRADIENT ON THE DIRTY SPANS - PARALLEL
+// ============================================================================
+
+// gaussianBlurWorker within two pixels of a changed tile
+static void* incrementalBlurWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+
+    for (int i = data->startRow; i < data->endRow; i++) {
+        forEachDirtySpan(data->tileActive, data->tileCols, data->sizeRows, data->sizeCols, i, 2,
+                         [&](int startCol, int endCol) {
+            for (int j = startCol; j < endCol; j++) {
+                for (int k = 0; k < data->sizeDepth; k++) {
+                    (*data->outputPixels)[i * data->sizeCols * data->sizeDepth + j * data->sizeDepth + k] =
+                        blurPixel(data, i, j, k);
+                }
+            }
+        });
+    }
+    return nullptr;
+}
+
+// Same arithmetic as rgbToGrayscaleWorker, within two pixels of a changed tile
+static void* incrementalGrayWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+
+    for (int i = data->startRow; i < data->endRow; i++) {
+        forEachDirtySpan(data->tileActive, data->tileCols, data->sizeRows, data->sizeCols, i, 2,
+                         [&](int startCol, int endCol) {
+            for (int j = startCol; j < endCol; j++) {
+                int sum = 0;
+                for (int k = 0; k < data->sizeDepth; k++) {
+                    sum += (*data->inputPixels)[i * data->sizeCols * data->sizeDepth + j * data->sizeDepth + k];
+                }
+                (*data->outputPixels)[i * data->sizeCols + j] = (int)(sum / data->sizeDepth);
+            }
+        });
+    }
+    return nullptr;
+}
+
+// Same arithmetic as cannyPhase1Worker, within three pixels of a changed tile
+static void* incrementalGradientWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+
+    int gx[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+    int gy[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+    int startRow = std::max(1, data->startRow);
+    int endRow = std::min(data->sizeRows - 1, data->endRow);
+
+    for (int i = startRow; i < endRow; i++) {
+        forEachDirtySpan(data->tileActive, data->tileCols, data->sizeRows, data->sizeCols, i, 3,
+                         [&](int spanStart, int spanEnd) {
+            int startCol = std::max(1, spanStart);
+            int endCol = std::min(data->sizeCols - 1, spanEnd);
+            for (int j = startCol; j < endCol; j++) {
+                double gxValue = 0;
+                double gyValue = 0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        gxValue += gx[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
+                        gyValue += gy[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
+                    }
+                }
+
+                data->G[i * data->sizeCols + j] = std::sqrt(gxValue * gxValue + gyValue * gyValue);
+                double atanResult = atan2(gyValue, gxValue) * 180.0 / 3.14159265;
+                (*data->theta)[i * data->sizeCols + j] = (int)(180.0 + atanResult);
+                (*data->theta)[i * data->sizeCols + j] = ((*data->theta)[i * data->sizeCols + j] / 45) * 45;
+            }
+        });
+    }
+    return nullptr;
+}
+
+// One band per thread over all rows
+static std::vector<ThreadData> rowBands(const ThreadData& base, int sizeRows) {
+    int numBands = std::max(1, std::min(getNumThreads(), sizeRows));
+    std::vector<ThreadData> threadData(numBands, base);
+    for (int t = 0; t < numBands; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numThreads = numBands;
+        threadData[t].startRow = sizeRows * t / numBands;
+        threadData[t].endRow = sizeRows * (t + 1) / numBands;
+    }
+    return threadData;
+}
+
+// ============================================================================
+// NMS AND HYSTERESIS - SEQUENTIAL
+// ============================================================================
+
+// cannyPhase2Worker on one pixel of a single band: neighbours earlier in
+// raster order have already been suppressed, later ones not yet
+static inline double suppressedValue(const IncrementalState& s, int i, int j) {
+    int sizeCols = s.sizeCols;
+    int p = i * sizeCols + j;
+    auto at = [&](int r, int c) {
+        int q = r * sizeCols + c;
+        return q < p ? s.Gnms[q] : s.G[q];
+    };
+    int theta = s.theta[p];
+    double currentG = s.G[p];
+    bool suppress;
+    if (theta == 0 || theta == 180) {
+        suppress = currentG < at(i, j - 1) || currentG < at(i, j + 1);
+    } else if (theta == 45 || theta == 225) {
+        suppress = currentG < at(i + 1, j + 1) || currentG < at(i - 1, j - 1);
+    } else if (theta == 90 || theta == 270) {
+        suppress = currentG < at(i + 1, j) || currentG < at(i - 1, j);
+    } else {
+        suppress = currentG < at(i + 1, j - 1) || currentG < at(i - 1, j + 1);
+    }
+    return suppress ? 0.0 : currentG;
+}
+
+// First cannyHysteresis pass on one pixel: earlier neighbours are final,
+// later ones still hold their suppressed magnitude. With lowerThreshold > 0
+// the first pass is also the last, since a weak pixel left unpromoted drops
+// to 0, below the low threshold.
+static inline double hysteresisValue(const IncrementalState& s, int i, int j) {
+    int sizeCols = s.sizeCols;
+    int p = i * sizeCols + j;
+    double value = s.Gnms[p];
+    if (value < (s.lowerThreshold * s.largestG)) return 0;
+    if (value >= (s.higherThreshold * s.largestG)) return value;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            if (x == 0 && y == 0) continue;
+            int q = (i + x) * sizeCols + (j + y);
+            if ((q < p ? s.Gedge[q] : s.Gnms[q]) >= (s.higherThreshold * s.largestG)) {
+                return s.higherThreshold * s.largestG;
+            }
+        }
+    }
+    return 0;
+}
+
+// Edge pixels copied from their neighbours, in the order of
+// cannyFilter_parallel. NMS and hysteresis leave them as they are; a copy
+// that changes a value marks the neighbourhood for hysteresis.
+static void copyBorders(IncrementalState& s) {
+    int sizeRows = s.sizeRows;
+    int sizeCols = s.sizeCols;
+    double* G = s.G.data();
+    std::vector<int>& theta = s.theta;
+    auto update = [&](int i, int j) {
+        int p = i * sizeCols + j;
+        if (s.Gnms[p] == G[p]) return;
+        s.Gnms[p] = G[p];
+        s.Gedge[p] = G[p];
+        markAround(s.hysteresisMarks, sizeRows, sizeCols, i, j);
+    };
+    for (int j = 1; j < sizeCols - 1; j++) {
+        G[j] = G[sizeCols + j];
+        theta[j] = theta[sizeCols + j];
+        G[(sizeRows - 1) * sizeCols + j] = G[(sizeRows - 2) * sizeCols + j];
+        theta[(sizeRows - 1) * sizeCols + j] = theta[(sizeRows - 2) * sizeCols + j];
+        update(0, j);
+        update(sizeRows - 1, j);
+    }
+    for (int i = 0; i < sizeRows; i++) {
+        G[i * sizeCols] = G[i * sizeCols + 1];
+        theta[i * sizeCols] = theta[i * sizeCols + 1];
+        G[i * sizeCols + sizeCols - 1] = G[i * sizeCols + sizeCols - 2];
+        theta[i * sizeCols + sizeCols - 1] = theta[i * sizeCols + sizeCols - 2];
+        update(i, 0);
+        update(i, sizeCols - 1);
+    }
+}
+
+static void updateTileMax(IncrementalState& s, int tr, int tc, int tileCols) {
+    double largest = 0;
+    int endRow = std::min(s.sizeRows - 1, (tr + 1) * CANNY_TILE);
+    int endCol = std::min(s.sizeCols - 1, (tc + 1) * CANNY_TILE);
+    for (int i = std::max(1, tr * CANNY_TILE); i < endRow; i++) {
+        for (int j = std::max(1, tc * CANNY_TILE); j < endCol; j++) {
+            largest = std::max(largest, s.G[i * s.sizeCols + j]);
+        }
+    }
+    s.tileMaxG[tr * tileCols + tc] = largest;
+}
+
+// The thresholding of cannyFilter_parallel over the whole frame
+static void fullHysteresis(IncrementalState& s) {
+    int sizeRows = s.sizeRows;
+    int sizeCols = s.sizeCols;
+    s.Gedge = s.Gnms;
+    s.pixelsCanny.assign(sizeRows * sizeCols, 0);
+    for (int i = 1; i < sizeRows - 1; i++) {
+        for (int j = 1; j < sizeCols - 1; j++) {
+            s.pixelsCanny[i * sizeCols + j] = (int)(s.Gnms[i * sizeCols + j] * (255.0 / s.largestG));
+        }
+    }
+    HysteresisLimit saved = getHysteresisLimit();
+    setHysteresisLimit(HysteresisLimit{});
+    cannyHysteresis(s.Gedge.data(), s.pixelsCanny.data(), sizeRows, sizeCols,
+                    s.lowerThreshold, s.higherThreshold, s.largestG);
+    setHysteresisLimit(saved);
+}
+
+// ============================================================================
+// INCREMENTAL CANNY EDGE DETECTION - MAIN FUNCTION
+// ============================================================================
+
+void resetIncrementalState(IncrementalState& state) {
+    state.sizeRows = 0;
+    state.sizeCols = 0;
+    state.sizeDepth = 0;
+    std::vector<uint8_t>().swap(state.previous);
+}
+
+void cannyEdgeDetectionIncremental_parallel(const cv::Mat& img, IncrementalState& state,
+                                            double lowerThreshold, double higherThreshold,
+                                            IncrementalStats* stats) {
+    int sizeRows = img.rows;
+    int sizeCols = img.cols;
+    int sizeDepth = img.channels();
+    int tileRows = (sizeRows + CANNY_TILE - 1) / CANNY_TILE;
+    int tileCols = (sizeCols + CANNY_TILE - 1) / CANNY_TILE;
+    int numTiles = tileRows * tileCols;
+    size_t rowBytes = (size_t)sizeCols * sizeDepth;
+    IncrementalState& s = state;
+
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+
+    IncrementalStats local = {numTiles, 0, false, false, 0, 0};
+    bool sameShape = !s.previous.empty() && s.sizeRows == sizeRows && s.sizeCols == sizeCols &&
+                     s.sizeDepth == sizeDepth;
+    bool sameThresholds = s.lowerThreshold == lowerThreshold && s.higherThreshold == higherThreshold;
+
+    // Tiles that differ from the previous frame
+    s.changed.assign(numTiles, sameShape ? 0 : 1);
+    if (sameShape) {
+        for (int i = 0; i < sizeRows; i++) {
+            const uint8_t* row = img.ptr(i);
+            const uint8_t* previous = &s.previous[i * rowBytes];
+            uint8_t* changed = &s.changed[(i / CANNY_TILE) * tileCols];
+            for (int tc = 0; tc < tileCols; tc++) {
+                if (changed[tc]) continue;
+                size_t offset = (size_t)tc * CANNY_TILE * sizeDepth;
+                size_t bytes = (size_t)(std::min(sizeCols, (tc + 1) * CANNY_TILE) - tc * CANNY_TILE) * sizeDepth;
+                changed[tc] = memcmp(row + offset, previous + offset, bytes) != 0;
+            }
+        }
+    }
+    local.changedTiles = (int)std::count(s.changed.begin(), s.changed.end(), 1);
+    local.fullFrame = !sameShape || local.changedTiles > s.fullFrameRatio * numTiles;
+
+    s.sizeRows = sizeRows;
+    s.sizeCols = sizeCols;
+    s.sizeDepth = sizeDepth;
+    s.lowerThreshold = lowerThreshold;
+    s.higherThreshold = higherThreshold;
+    double previousLargestG = s.largestG;
+
+    ThreadData base = {};
+    base.sizeRows = sizeRows;
+    base.sizeCols = sizeCols;
+    base.sizeDepth = sizeDepth;
+    base.kernel = &kernel;
+    base.kernelConst = kernelConst;
+    base.theta = &s.theta;
+    base.tileActive = s.changed.data();
+    base.tileCols = tileCols;
+
+    if (local.fullFrame) {
+        s.previous.resize(sizeRows * rowBytes);
+        s.pixels.resize(sizeRows * rowBytes);
+        for (int i = 0; i < sizeRows; i++) {
+            const uint8_t* row = img.ptr(i);
+            memcpy(&s.previous[i * rowBytes], row, rowBytes);
+            // Same conversion as imgToArray
+            for (int j = 0; j < sizeCols; j++) {
+                for (int k = 0; k < sizeDepth; k++) {
+                    s.pixels[i * rowBytes + j * sizeDepth + k] = (int)row[j * sizeDepth + sizeDepth - 1 - k];
+                }
+            }
+        }
+        gaussianBlur_parallel(s.pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, s.pixelsBlur);
+        rgbToGrayscale_parallel(s.pixelsBlur, sizeRows, sizeCols, sizeDepth, s.pixelsGray);
+
+        // Gradient, as in cannyFilter_parallel
+        s.G.assign(sizeRows * sizeCols, 0.0);
+        s.theta.assign(sizeRows * sizeCols, 0);
+        double largestG = 0;
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        base.sizeDepth = 1;
+        base.inputPixels = &s.pixelsGray;
+        base.G = s.G.data();
+        base.largestG = &largestG;
+        base.mutex = &mutex;
+        base.tileActive = nullptr;
+        std::vector<ThreadData> threadData = rowBands(base, sizeRows);
+        runThreads(cannyPhase1Worker, threadData.data(), (int)threadData.size(), (int)threadData.size());
+        pthread_mutex_destroy(&mutex);
+
+        // Borders are copied before NMS, so they need no tracking here
+        s.Gnms.assign(sizeRows * sizeCols, 0.0);
+        s.Gedge.assign(sizeRows * sizeCols, 0.0);
+        resetMarks(s.nmsMarks, sizeRows, sizeCols);
+        resetMarks(s.hysteresisMarks, sizeRows, sizeCols);
+        copyBorders(s);
+        resetMarks(s.hysteresisMarks, sizeRows, sizeCols);
+
+        s.tileMaxG.assign(numTiles, 0.0);
+        for (int t = 0; t < numTiles; t++) updateTileMax(s, t / tileCols, t % tileCols, tileCols);
+        s.largestG = largestG;
+
+        // NMS with a single band, so in raster order
+        s.Gnms = s.G;
+        s.pixelsCanny.assign(sizeRows * sizeCols, 0);
+        ThreadData nms = base;
+        nms.startRow = 0;
+        nms.endRow = sizeRows;
+        nms.G = s.Gnms.data();
+        nms.outputPixels = &s.pixelsCanny;
+        runThreads(cannyPhase2Worker, &nms, 1, 1);
+        local.nmsPixels = std::max(0, sizeRows - 2) * std::max(0, sizeCols - 2);
+
+        fullHysteresis(s);
+        local.rethresholded = true;
+        local.hysteresisPixels = local.nmsPixels;
+        if (stats) *stats = local;
+        return;
+    }
+
+    if (local.changedTiles > 0) {
+        // Keep the changed tiles of the new frame
+        for (int i = 0; i < sizeRows; i++) {
+            const uint8_t* row = img.ptr(i);
+            const uint8_t* changed = &s.changed[(i / CANNY_TILE) * tileCols];
+            for (int tc = 0; tc < tileCols; tc++) {
+                if (!changed[tc]) continue;
+                int endCol = std::min(sizeCols, (tc + 1) * CANNY_TILE);
+                for (int j = tc * CANNY_TILE; j < endCol; j++) {
+                    for (int k = 0; k < sizeDepth; k++) {
+                        s.pixels[i * rowBytes + j * sizeDepth + k] = (int)row[j * sizeDepth + sizeDepth - 1 - k];
+                    }
+                }
+                size_t offset = (size_t)tc * CANNY_TILE * sizeDepth;
+                memcpy(&s.previous[i * rowBytes + offset], row + offset,
+                       (size_t)(endCol - tc * CANNY_TILE) * sizeDepth);
+            }
+        }
+
+        // Blur, gray and gradient of the changed tiles and their halos (parallel)
+        base.inputPixels = &s.pixels;
+        base.outputPixels = &s.pixelsBlur;
+        std::vector<ThreadData> threadData = rowBands(base, sizeRows);
+        int numBands = (int)threadData.size();
+        runThreads(incrementalBlurWorker, threadData.data(), numBands, numBands);
+        for (ThreadData& data : threadData) {
+            data.inputPixels = &s.pixelsBlur;
+            data.outputPixels = &s.pixelsGray;
+        }
+        runThreads(incrementalGrayWorker, threadData.data(), numBands, numBands);
+        for (ThreadData& data : threadData) {
+            data.sizeDepth = 1;
+            data.inputPixels = &s.pixelsGray;
+            data.G = s.G.data();
+        }
+        runThreads(incrementalGradientWorker, threadData.data(), numBands, numBands);
+        copyBorders(s);
+
+        // The gradient halo reaches into the neighbouring tiles
+        for (int tr = 0; tr < tileRows; tr++) {
+            for (int tc = 0; tc < tileCols; tc++) {
+                bool near = false;
+                for (int r = std::max(0, tr - 1); r <= std::min(tileRows - 1, tr + 1) && !near; r++) {
+                    for (int c = std::max(0, tc - 1); c <= std::min(tileCols - 1, tc + 1) && !near; c++) {
+                        near = s.changed[r * tileCols + c];
+                    }
+                }
+                if (near) updateTileMax(s, tr, tc, tileCols);
+            }
+        }
+        s.largestG = *std::max_element(s.tileMaxG.begin(), s.tileMaxG.end());
+
+        // NMS of every pixel next to a new gradient, then of every later
+        // pixel that reads a suppressed value that changed
+        for (int i = 1; i < sizeRows - 1; i++) {
+            forEachDirtySpan(s.changed.data(), tileCols, sizeRows, sizeCols, i, 4, [&](int startCol, int endCol) {
+                for (int j = startCol; j < endCol; j++) mark(s.nmsMarks, sizeRows, sizeCols, i, j);
+            });
+        }
+        local.nmsPixels = sweepMarks(s.nmsMarks, sizeRows, sizeCols, [&](int i, int j) {
+            int p = i * sizeCols + j;
+            double value = suppressedValue(s, i, j);
+            if (value == s.Gnms[p]) return;
+            s.Gnms[p] = value;
+            markLater(s.nmsMarks, sizeRows, sizeCols, i, j);
+            markAround(s.hysteresisMarks, sizeRows, sizeCols, i, j);
+        });
+    }
+
+    local.rethresholded = !sameThresholds || s.largestG != previousLargestG || lowerThreshold <= 0;
+    if (local.rethresholded) {
+        sweepMarks(s.hysteresisMarks, sizeRows, sizeCols, [](int, int) {});
+        fullHysteresis(s);
+        local.hysteresisPixels = std::max(0, sizeRows - 2) * std::max(0, sizeCols - 2);
+    } else {
+        // Hysteresis of every pixel next to a new suppressed value, then of
+        // every later pixel that reads a final value that changed
+        local.hysteresisPixels = sweepMarks(s.hysteresisMarks, sizeRows, sizeCols, [&](int i, int j) {
+            int p = i * sizeCols + j;
+            double value = hysteresisValue(s, i, j);
+            s.pixelsCanny[p] = (int)(value * (255.0 / s.largestG));
+            if (value == s.Gedge[p]) return;
+            s.Gedge[p] = value;
+            markLater(s.hysteresisMarks, sizeRows, sizeCols, i, j);
+        });
+    }
+    if (stats) *stats = local;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <opencv2/highgui.hpp>
+
+#include "canny_parallel.h"
+
+// Incremental mode for static-camera video.
+//
+// Each frame is compared with the previous one per CANNY_TILE x CANNY_TILE
+// tile. Blur and gray are recomputed for the changed tiles plus a two-pixel
+// halo, the gradient plus a three-pixel halo, and the cached results are
+// kept everywhere else. NMS and hysteresis are sequential in raster order (a
+// pixel reads its already processed neighbours), so both are redone for the
+// pixels near a changed gradient and then for every later pixel whose
+// inputs changed as a result, until the change dies out. If the largest
+// gradient of the frame moves, the thresholds move with it and hysteresis is
+// redone over the whole frame; with lowerThreshold <= 0 hysteresis needs
+// several passes and is always redone in full.
+//
+// The edge map is identical to a full run of the exact channel-first
+// pipeline with one thread (multi-threaded NMS races at band seams and is
+// not deterministic). Hysteresis limits (setHysteresisLimit) are ignored.
+
+struct IncrementalStats {
+    int numTiles;
+    int changedTiles;
+    bool fullFrame;        // everything recomputed (first frame, new size, large change)
+    bool rethresholded;    // hysteresis over the whole frame (thresholds or largest gradient moved)
+    int nmsPixels;         // pixels revisited by NMS
+    int hysteresisPixels;  // pixels revisited by hysteresis
+};
+
+// Pixels waiting to be revisited, with the marked column range of each row
+struct PixelMarks {
+    std::vector<uint8_t> marks;  // all zero between frames
+    std::vector<int> first;
+    std::vector<int> last;
+};
+
+// Cached intermediate results of the previous frame
+struct IncrementalState {
+    int sizeRows = 0;
+    int sizeCols = 0;
+    int sizeDepth = 0;
+    double lowerThreshold = 0;
+    double higherThreshold = 0;
+    double largestG = 0;
+    // Above this fraction of changed tiles the whole frame is recomputed
+    double fullFrameRatio = 0.5;
+
+    std::vector<uint8_t> previous;   // last frame, rows * cols * depth bytes
+    std::vector<int> pixels;         // RGB ints as in imgToArray
+    std::vector<int> pixelsBlur;
+    std::vector<int> pixelsGray;
+    std::vector<double> G;           // Sobel magnitude, border rows/cols copied
+    std::vector<int> theta;
+    std::vector<double> Gnms;        // after non-maximum suppression
+    std::vector<double> Gedge;       // after hysteresis
+    std::vector<double> tileMaxG;    // largest interior magnitude per tile
+    std::vector<int> pixelsCanny;    // edge map, sizeRows * sizeCols values in 0..255
+
+    // Scratch
+    std::vector<uint8_t> changed;    // per tile
+    PixelMarks nmsMarks;
+    PixelMarks hysteresisMarks;
+};
+
+// Process the next frame of a sequence. The edge map is left in
+// state.pixelsCanny. Uses getNumThreads() threads for the blur, gray and
+// gradient stages.
+void cannyEdgeDetectionIncremental_parallel(const cv::Mat& img, IncrementalState& state,
+                                            double lowerThreshold, double higherThreshold,
+                                            IncrementalStats* stats = nullptr);
+
+// Forget the cached frame; the next call recomputes everything
+void resetIncrementalState(IncrementalState& state);
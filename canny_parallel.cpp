@@ -1,17 +1,166 @@
 #include "canny_parallel.h"
 #include "canny.h"
+#include "canny_tuning.h"
 #include <chrono>
 #include <algorithm>
 #include <cstring>
 
 static int g_numThreads = 1;
+static CannyPrecision g_precision = PRECISION_EXACT;
+static PipelineMode g_pipelineMode = PIPELINE_CHANNEL_FIRST;
+static MemoryMode g_memoryMode = MEMORY_DEFAULT;
+static SparsityMode g_sparsityMode = SPARSITY_DENSE;
+// Per-calling-thread override of g_numThreads, 0 when unset
+static thread_local int t_numThreads = 0;
+// Per-calling-thread stage settings, all defaults when unset
+static thread_local TuningConfig t_tuning = {};
+// Tile counts of the last exact cannyFilter on this thread
+static thread_local TileStats t_tileStats = {};
+// Hysteresis bounds for this thread and how its last hysteresis ended
+static thread_local HysteresisLimit t_hysteresisLimit = {};
+static thread_local HysteresisOutcome t_hysteresisOutcome = HYSTERESIS_COMPLETE;
 
 void setNumThreads(int n) {
     g_numThreads = std::max(1, std::min(n, 16));
 }
 
+void setThreadLocalNumThreads(int n) {
+    t_numThreads = (n <= 0) ? 0 : std::max(1, std::min(n, 16));
+}
+
 int getNumThreads() {
-    return g_numThreads;
+    return t_numThreads ? t_numThreads : g_numThreads;
+}
+
+void setTuningConfig(const TuningConfig& config) {
+    t_tuning = config;
+}
+
+TuningConfig getTuningConfig() {
+    return t_tuning;
+}
+
+// Row bands of one stage run
+struct StageBands {
+    int numThreads;  // bands in flight at once
+    int numBands;
+    int chunkRows;   // 0: one band per thread, the last one takes the remainder
+};
+
+static StageBands stageBands(CannyStage stage, int sizeRows) {
+    const StageConfig& config = t_tuning.stages[stage];
+    StageBands bands;
+    bands.numThreads = config.numThreads > 0 ? std::min(config.numThreads, getNumThreads()) : getNumThreads();
+    bands.chunkRows = std::max(0, config.chunkRows);
+    if (bands.chunkRows == 0 || sizeRows <= 0) {
+        bands.chunkRows = 0;
+        bands.numBands = bands.numThreads;
+    } else {
+        bands.numBands = (sizeRows + bands.chunkRows - 1) / bands.chunkRows;
+    }
+    return bands;
+}
+
+static void setBandRows(ThreadData& data, const StageBands& bands, int band, int sizeRows) {
+    if (bands.chunkRows == 0) {
+        int rowsPerThread = sizeRows / bands.numBands;
+        data.startRow = band * rowsPerThread;
+        data.endRow = (band == bands.numBands - 1) ? sizeRows : (band + 1) * rowsPerThread;
+    } else {
+        data.startRow = band * bands.chunkRows;
+        data.endRow = std::min(sizeRows, (band + 1) * bands.chunkRows);
+    }
+}
+
+void setPrecisionMode(CannyPrecision precision) {
+    g_precision = precision;
+}
+
+CannyPrecision getPrecisionMode() {
+    return g_precision;
+}
+
+const char* precisionModeName(CannyPrecision precision) {
+    switch (precision) {
+    case PRECISION_EXACT: return "exact";
+    case PRECISION_FAST_L1: return "fast-l1";
+    case PRECISION_FAST_L2SQ: return "fast-l2sq";
+    }
+    return "unknown";
+}
+
+void setPipelineMode(PipelineMode mode) {
+    g_pipelineMode = mode;
+}
+
+PipelineMode getPipelineMode() {
+    return g_pipelineMode;
+}
+
+const char* pipelineModeName(PipelineMode mode) {
+    switch (mode) {
+    case PIPELINE_CHANNEL_FIRST: return "channel-first";
+    case PIPELINE_LUMA_AVERAGE: return "luma-average";
+    case PIPELINE_LUMA_BT601: return "luma-bt601";
+    }
+    return "unknown";
+}
+
+void setMemoryMode(MemoryMode mode) {
+    g_memoryMode = mode;
+}
+
+MemoryMode getMemoryMode() {
+    return g_memoryMode;
+}
+
+const char* memoryModeName(MemoryMode mode) {
+    switch (mode) {
+    case MEMORY_DEFAULT: return "default";
+    case MEMORY_LOW: return "low";
+    }
+    return "unknown";
+}
+
+void setSparsityMode(SparsityMode mode) {
+    g_sparsityMode = mode;
+}
+
+SparsityMode getSparsityMode() {
+    return g_sparsityMode;
+}
+
+const char* sparsityModeName(SparsityMode mode) {
+    switch (mode) {
+    case SPARSITY_DENSE: return "dense";
+    case SPARSITY_SKIP_FLAT: return "skip-flat";
+    }
+    return "unknown";
+}
+
+TileStats getLastTileStats() {
+    return t_tileStats;
+}
+
+void setHysteresisLimit(const HysteresisLimit& limit) {
+    t_hysteresisLimit = limit;
+}
+
+HysteresisLimit getHysteresisLimit() {
+    return t_hysteresisLimit;
+}
+
+HysteresisOutcome getLastHysteresisOutcome() {
+    return t_hysteresisOutcome;
+}
+
+const char* hysteresisOutcomeName(HysteresisOutcome outcome) {
+    switch (outcome) {
+    case HYSTERESIS_COMPLETE: return "complete";
+    case HYSTERESIS_BOUNDED: return "bounded";
+    case HYSTERESIS_ABANDONED: return "abandoned";
+    }
+    return "unknown";
 }
 
 double getCurrentTimeMs() {
@@ -24,27 +173,74 @@ double getCurrentTimeMs() {
 // GAUSSIAN BLUR - PARALLEL VERSION
 // ============================================================================
 
+void makeGaussianKernel(std::vector<std::vector<double>>& kernel, double& kernelConst) {
+    kernel = {{2.0, 4.0, 5.0, 4.0, 2.0},
+              {4.0, 9.0, 12.0, 9.0, 4.0},
+              {5.0, 12.0, 15.0, 12.0, 5.0},
+              {4.0, 9.0, 12.0, 9.0, 4.0},
+              {2.0, 4.0, 5.0, 4.0, 2.0}};
+    kernelConst = (1.0 / 159.0);
+}
+
+// The one blur definition. Checked = false is only for pixels at least two
+// away from the border: the bounds tests compile away, and the taps are
+// accumulated in the same order with the same expressions, so the output
+// is bit-identical to the checked form.
+template <bool Checked>
+static inline int blurPixelAt(const ThreadData* data, int i, int j, int k) {
+    double sum = 0;
+    double sumKernel = 0;
+    for (int y = -2; y <= 2; y++) {
+        for (int x = -2; x <= 2; x++) {
+            if (!Checked || ((i + x) >= 0 && (i + x) < data->sizeRows && 
+                             (j + y) >= 0 && (j + y) < data->sizeCols)) {
+                double channel = (double)(*data->inputPixels)[(i + x) * data->sizeCols * data->sizeDepth + 
+                                                               (j + y) * data->sizeDepth + k];
+                sum += channel * data->kernelConst * (*data->kernel)[x + 2][y + 2];
+                sumKernel += data->kernelConst * (*data->kernel)[x + 2][y + 2];
+            }
+        }
+    }
+    return (int)(sum / sumKernel);
+}
+
+int blurPixel(const ThreadData* data, int i, int j, int k) {
+    return blurPixelAt<true>(data, i, j, k);
+}
+
 void* gaussianBlurWorker(void* arg) {
     ThreadData* data = (ThreadData*)arg;
     
     for (int i = data->startRow; i < data->endRow; i++) {
         for (int j = 0; j < data->sizeCols; j++) {
             for (int k = 0; k < data->sizeDepth; k++) {
-                double sum = 0;
-                double sumKernel = 0;
-                for (int y = -2; y <= 2; y++) {
-                    for (int x = -2; x <= 2; x++) {
-                        if ((i + x) >= 0 && (i + x) < data->sizeRows && 
-                            (j + y) >= 0 && (j + y) < data->sizeCols) {
-                            double channel = (double)(*data->inputPixels)[(i + x) * data->sizeCols * data->sizeDepth + 
-                                                                           (j + y) * data->sizeDepth + k];
-                            sum += channel * data->kernelConst * (*data->kernel)[x + 2][y + 2];
-                            sumKernel += data->kernelConst * (*data->kernel)[x + 2][y + 2];
-                        }
-                    }
-                }
                 (*data->outputPixels)[i * data->sizeCols * data->sizeDepth + j * data->sizeDepth + k] = 
-                    (int)(sum / sumKernel);
+                    blurPixelAt<true>(data, i, j, k);
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Same blur, with the unchecked form for the pixels away from the border
+void* gaussianBlurInteriorWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    int sizeCols = data->sizeCols;
+    int sizeDepth = data->sizeDepth;
+    bool interiorRows = data->sizeRows >= 5 && sizeCols >= 5;
+
+    for (int i = data->startRow; i < data->endRow; i++) {
+        bool interiorRow = interiorRows && i >= 2 && i < data->sizeRows - 2;
+        int* out = data->outputPixels->data() + (size_t)i * sizeCols * sizeDepth;
+        for (int j = 0; j < sizeCols; j++) {
+            if (interiorRow && j >= 2 && j < sizeCols - 2) {
+                for (int k = 0; k < sizeDepth; k++) {
+                    out[j * sizeDepth + k] = blurPixelAt<false>(data, i, j, k);
+                }
+            } else {
+                for (int k = 0; k < sizeDepth; k++) {
+                    out[j * sizeDepth + k] = blurPixelAt<true>(data, i, j, k);
+                }
             }
         }
     }
@@ -53,19 +249,23 @@ void* gaussianBlurWorker(void* arg) {
 
 std::vector<int> gaussianBlur_parallel(std::vector<int>& pixels, std::vector<std::vector<double>>& kernel, 
                                         double kernelConst, int sizeRows, int sizeCols, int sizeDepth) {
-    std::vector<int> pixelsBlur(sizeRows * sizeCols * sizeDepth);
-    int numThreads = g_numThreads;
-    
-    pthread_t threads[numThreads];
-    ThreadData threadData[numThreads];
+    std::vector<int> pixelsBlur;
+    gaussianBlur_parallel(pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, pixelsBlur);
+    return pixelsBlur;
+}
+
+void gaussianBlur_parallel(std::vector<int>& pixels, std::vector<std::vector<double>>& kernel, 
+                           double kernelConst, int sizeRows, int sizeCols, int sizeDepth, 
+                           std::vector<int>& pixelsBlur) {
+    pixelsBlur.resize(sizeRows * sizeCols * sizeDepth);
+    StageBands bands = stageBands(STAGE_BLUR, sizeRows);
     
-    int rowsPerThread = sizeRows / numThreads;
+    std::vector<ThreadData> threadData(bands.numBands);
     
-    for (int t = 0; t < numThreads; t++) {
+    for (int t = 0; t < bands.numBands; t++) {
         threadData[t].threadId = t;
-        threadData[t].numThreads = numThreads;
-        threadData[t].startRow = t * rowsPerThread;
-        threadData[t].endRow = (t == numThreads - 1) ? sizeRows : (t + 1) * rowsPerThread;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
         threadData[t].sizeRows = sizeRows;
         threadData[t].sizeCols = sizeCols;
         threadData[t].sizeDepth = sizeDepth;
@@ -73,15 +273,11 @@ std::vector<int> gaussianBlur_parallel(std::vector<int>& pixels, std::vector<std
         threadData[t].outputPixels = &pixelsBlur;
         threadData[t].kernel = &kernel;
         threadData[t].kernelConst = kernelConst;
-        
-        pthread_create(&threads[t], nullptr, gaussianBlurWorker, &threadData[t]);
-    }
-    
-    for (int t = 0; t < numThreads; t++) {
-        pthread_join(threads[t], nullptr);
     }
     
-    return pixelsBlur;
+    void* (*worker)(void*) = t_tuning.blurKernel == BLUR_KERNEL_INTERIOR ? gaussianBlurInteriorWorker 
+                                                                          : gaussianBlurWorker;
+    runThreads(worker, threadData.data(), bands.numBands, bands.numThreads);
 }
 
 // ============================================================================
@@ -104,39 +300,195 @@ void* rgbToGrayscaleWorker(void* arg) {
 }
 
 std::vector<int> rgbToGrayscale_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth) {
-    std::vector<int> pixelsGray(sizeRows * sizeCols);
-    int numThreads = g_numThreads;
-    
-    pthread_t threads[numThreads];
-    ThreadData threadData[numThreads];
+    std::vector<int> pixelsGray;
+    rgbToGrayscale_parallel(pixels, sizeRows, sizeCols, sizeDepth, pixelsGray);
+    return pixelsGray;
+}
+
+void rgbToGrayscale_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                             std::vector<int>& pixelsGray) {
+    pixelsGray.resize(sizeRows * sizeCols);
+    StageBands bands = stageBands(STAGE_GRAY, sizeRows);
     
-    int rowsPerThread = sizeRows / numThreads;
+    std::vector<ThreadData> threadData(bands.numBands);
     
-    for (int t = 0; t < numThreads; t++) {
+    for (int t = 0; t < bands.numBands; t++) {
         threadData[t].threadId = t;
-        threadData[t].numThreads = numThreads;
-        threadData[t].startRow = t * rowsPerThread;
-        threadData[t].endRow = (t == numThreads - 1) ? sizeRows : (t + 1) * rowsPerThread;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
         threadData[t].sizeRows = sizeRows;
         threadData[t].sizeCols = sizeCols;
         threadData[t].sizeDepth = sizeDepth;
         threadData[t].inputPixels = &pixels;
         threadData[t].outputPixels = &pixelsGray;
-        
-        pthread_create(&threads[t], nullptr, rgbToGrayscaleWorker, &threadData[t]);
     }
     
-    for (int t = 0; t < numThreads; t++) {
-        pthread_join(threads[t], nullptr);
+    runThreads(rgbToGrayscaleWorker, threadData.data(), bands.numBands, bands.numThreads);
+}
+
+// In-place variant: each band writes its gray values to the start of its own
+// input rows. Pixel p of a band is written at or before the first channel it
+// was read from, so a band never overwrites input it still needs.
+void* rgbToGrayscaleInPlaceWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    int* pixels = data->outputPixels->data();
+    int* dst = pixels + (size_t)data->startRow * data->sizeCols * data->sizeDepth;
+
+    for (int i = data->startRow; i < data->endRow; i++) {
+        for (int j = 0; j < data->sizeCols; j++) {
+            const int* px = pixels + ((size_t)i * data->sizeCols + j) * data->sizeDepth;
+            int sum = 0;
+            for (int k = 0; k < data->sizeDepth; k++) {
+                sum += px[k];
+            }
+            *dst++ = (int)(sum / data->sizeDepth);
+        }
     }
-    
-    return pixelsGray;
+    return nullptr;
+}
+
+void rgbToGrayscaleInPlace_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth) {
+    if (sizeDepth == 1) return;
+    StageBands bands = stageBands(STAGE_GRAY, sizeRows);
+    std::vector<ThreadData> threadData(bands.numBands);
+
+    for (int t = 0; t < bands.numBands; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
+        threadData[t].sizeRows = sizeRows;
+        threadData[t].sizeCols = sizeCols;
+        threadData[t].sizeDepth = sizeDepth;
+        threadData[t].outputPixels = &pixels;
+    }
+
+    runThreads(rgbToGrayscaleInPlaceWorker, threadData.data(), bands.numBands, bands.numThreads);
+
+    // Compact the bands in order; each destination lies before every later
+    // band's source, so nothing unread is overwritten
+    for (int t = 0; t < bands.numBands; t++) {
+        size_t count = (size_t)(threadData[t].endRow - threadData[t].startRow) * sizeCols;
+        memmove(pixels.data() + (size_t)threadData[t].startRow * sizeCols, 
+                pixels.data() + (size_t)threadData[t].startRow * sizeCols * sizeDepth, count * sizeof(int));
+    }
+    pixels.resize(sizeRows * sizeCols);
+}
+
+// ============================================================================
+// LUMA-FIRST BLUR - PARALLEL VERSION
+// ============================================================================
+
+// Weighted channel sum straight from the BGR(A) or gray cv::Mat data
+void* lumaConvertWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    const uint8_t* src = data->imagePixels;
+    int* dst = data->outputPixels->data();
+
+    for (int i = data->startRow; i < data->endRow; i++) {
+        for (int j = 0; j < data->sizeCols; j++) {
+            const uint8_t* px = src + (i * data->sizeCols + j) * data->sizeDepth;
+            int sum = 0;
+            for (int k = 0; k < data->sizeDepth; k++) {
+                sum += data->grayWeights[k] * px[k];
+            }
+            dst[i * data->sizeCols + j] = sum;
+        }
+    }
+    return nullptr;
+}
+
+// Scale the blurred sums back to gray levels
+void* lumaDivideWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    const int* src = data->inputPixels->data();
+    int* dst = data->outputPixels->data();
+
+    for (int i = data->startRow * data->sizeCols; i < data->endRow * data->sizeCols; i++) {
+        dst[i] = src[i] / data->grayDivisor;
+    }
+    return nullptr;
+}
+
+void lumaBlur_parallel(const cv::Mat& img, PipelineMode mode, std::vector<std::vector<double>>& kernel, 
+                       double kernelConst, std::vector<int>& pixelsLuma, std::vector<int>& pixelsBlur, 
+                       std::vector<int>& pixelsGray) {
+    int sizeRows = img.rows;
+    int sizeCols = img.cols;
+    int sizeDepth = img.channels();
+    pixelsLuma.resize(sizeRows * sizeCols);
+    pixelsGray.resize(sizeRows * sizeCols);
+
+    if (sizeDepth > LUMA_MAX_CHANNELS) {
+        // No per-channel weights for this depth: blur the channels, then average
+        pixelsLuma = imgToArray(img, (uint8_t*)img.data, sizeRows, sizeCols, sizeDepth);
+        gaussianBlur_parallel(pixelsLuma, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, pixelsBlur);
+        rgbToGrayscaleInPlace_parallel(pixelsBlur, sizeRows, sizeCols, sizeDepth);
+        pixelsBlur.resize(sizeRows * sizeCols);
+        if (&pixelsGray != &pixelsBlur) pixelsGray = pixelsBlur;
+        return;
+    }
+
+    // Average of every channel (alpha included, as in the channel-first
+    // path), or BT.601 on B, G, R with any alpha ignored
+    int weights[LUMA_MAX_CHANNELS] = {1, 1, 1, 1};
+    int divisor = sizeDepth;
+    if (mode == PIPELINE_LUMA_BT601 && sizeDepth >= 3) {
+        weights[0] = 29;
+        weights[1] = 150;
+        weights[2] = 77;
+        weights[3] = 0;
+        divisor = 256;
+    }
+
+    StageBands bands = stageBands(STAGE_GRAY, sizeRows);
+    std::vector<ThreadData> threadData(bands.numBands);
+    for (int t = 0; t < bands.numBands; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
+        threadData[t].sizeRows = sizeRows;
+        threadData[t].sizeCols = sizeCols;
+        threadData[t].sizeDepth = sizeDepth;
+        threadData[t].imagePixels = (const uint8_t*)img.data;
+        threadData[t].outputPixels = &pixelsLuma;
+        for (int k = 0; k < LUMA_MAX_CHANNELS; k++) {
+            threadData[t].grayWeights[k] = weights[k];
+        }
+        threadData[t].grayDivisor = divisor;
+    }
+
+    runThreads(lumaConvertWorker, threadData.data(), bands.numBands, bands.numThreads);
+
+    gaussianBlur_parallel(pixelsLuma, kernel, kernelConst, sizeRows, sizeCols, 1, pixelsBlur);
+
+    for (int t = 0; t < bands.numBands; t++) {
+        threadData[t].inputPixels = &pixelsBlur;
+        threadData[t].outputPixels = &pixelsGray;
+    }
+    runThreads(lumaDivideWorker, threadData.data(), bands.numBands, bands.numThreads);
 }
 
 // ============================================================================
 // CANNY FILTER - PARALLEL VERSION (Most Complex)
 // ============================================================================
 
+// Calls visit(j0, j1) for the interior column spans [j0, j1) of row i: the
+// whole row, or the runs of active tiles when a tile mask is given
+template <typename Visit>
+static inline void forEachSpan(const uint8_t* tileActive, int tileCols, int sizeCols, int i, Visit visit) {
+    if (!tileActive) {
+        visit(1, sizeCols - 1);
+        return;
+    }
+    const uint8_t* tiles = tileActive + (i / CANNY_TILE) * tileCols;
+    for (int t = 0; t < tileCols; t++) {
+        if (!tiles[t]) continue;
+        int first = t;
+        while (t + 1 < tileCols && tiles[t + 1]) t++;
+        visit(std::max(1, first * CANNY_TILE), std::min(sizeCols - 1, (t + 1) * CANNY_TILE));
+    }
+}
+
 // Phase 1: Compute gradient magnitude and direction
 void* cannyPhase1Worker(void* arg) {
     ThreadData* data = (ThreadData*)arg;
@@ -151,25 +503,27 @@ void* cannyPhase1Worker(void* arg) {
     int endRow = std::min(data->sizeRows - 1, data->endRow);
     
     for (int i = startRow; i < endRow; i++) {
-        for (int j = 1; j < data->sizeCols - 1; j++) {
-            double gxValue = 0;
-            double gyValue = 0;
-            for (int x = -1; x <= 1; x++) {
-                for (int y = -1; y <= 1; y++) {
-                    gxValue += gx[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
-                    gyValue += gy[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
+        forEachSpan(data->tileActive, data->tileCols, data->sizeCols, i, [&](int startCol, int endCol) {
+            for (int j = startCol; j < endCol; j++) {
+                double gxValue = 0;
+                double gyValue = 0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        gxValue += gx[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
+                        gyValue += gy[1 - x][1 - y] * (double)((*data->inputPixels)[(i + x) * data->sizeCols + j + y]);
+                    }
+                }
+                
+                data->G[i * data->sizeCols + j] = std::sqrt(gxValue * gxValue + gyValue * gyValue);
+                double atanResult = atan2(gyValue, gxValue) * 180.0 / 3.14159265;
+                (*data->theta)[i * data->sizeCols + j] = (int)(180.0 + atanResult);
+                (*data->theta)[i * data->sizeCols + j] = ((*data->theta)[i * data->sizeCols + j] / 45) * 45;
+                
+                if (data->G[i * data->sizeCols + j] > localLargestG) {
+                    localLargestG = data->G[i * data->sizeCols + j];
                 }
             }
-            
-            data->G[i * data->sizeCols + j] = std::sqrt(gxValue * gxValue + gyValue * gyValue);
-            double atanResult = atan2(gyValue, gxValue) * 180.0 / 3.14159265;
-            (*data->theta)[i * data->sizeCols + j] = (int)(180.0 + atanResult);
-            (*data->theta)[i * data->sizeCols + j] = ((*data->theta)[i * data->sizeCols + j] / 45) * 45;
-            
-            if (data->G[i * data->sizeCols + j] > localLargestG) {
-                localLargestG = data->G[i * data->sizeCols + j];
-            }
-        }
+        });
     }
     
     // Update global largestG with mutex
@@ -191,60 +545,215 @@ void* cannyPhase2Worker(void* arg) {
     double largestG = *(data->largestG);
     
     for (int i = startRow; i < endRow; i++) {
-        for (int j = 1; j < data->sizeCols - 1; j++) {
-            int theta = (*data->theta)[i * data->sizeCols + j];
-            double currentG = data->G[i * data->sizeCols + j];
-            
-            if (theta == 0 || theta == 180) {
-                if (currentG < data->G[i * data->sizeCols + j - 1] || 
-                    currentG < data->G[i * data->sizeCols + j + 1]) {
-                    data->G[i * data->sizeCols + j] = 0;
-                }
-            } else if (theta == 45 || theta == 225) {
-                if (currentG < data->G[(i + 1) * data->sizeCols + j + 1] || 
-                    currentG < data->G[(i - 1) * data->sizeCols + j - 1]) {
-                    data->G[i * data->sizeCols + j] = 0;
-                }
-            } else if (theta == 90 || theta == 270) {
-                if (currentG < data->G[(i + 1) * data->sizeCols + j] || 
-                    currentG < data->G[(i - 1) * data->sizeCols + j]) {
-                    data->G[i * data->sizeCols + j] = 0;
+        forEachSpan(data->tileActive, data->tileCols, data->sizeCols, i, [&](int startCol, int endCol) {
+            for (int j = startCol; j < endCol; j++) {
+                int theta = (*data->theta)[i * data->sizeCols + j];
+                double currentG = data->G[i * data->sizeCols + j];
+                
+                if (theta == 0 || theta == 180) {
+                    if (currentG < data->G[i * data->sizeCols + j - 1] || 
+                        currentG < data->G[i * data->sizeCols + j + 1]) {
+                        data->G[i * data->sizeCols + j] = 0;
+                    }
+                } else if (theta == 45 || theta == 225) {
+                    if (currentG < data->G[(i + 1) * data->sizeCols + j + 1] || 
+                        currentG < data->G[(i - 1) * data->sizeCols + j - 1]) {
+                        data->G[i * data->sizeCols + j] = 0;
+                    }
+                } else if (theta == 90 || theta == 270) {
+                    if (currentG < data->G[(i + 1) * data->sizeCols + j] || 
+                        currentG < data->G[(i - 1) * data->sizeCols + j]) {
+                        data->G[i * data->sizeCols + j] = 0;
+                    }
+                } else {
+                    if (currentG < data->G[(i + 1) * data->sizeCols + j - 1] || 
+                        currentG < data->G[(i - 1) * data->sizeCols + j + 1]) {
+                        data->G[i * data->sizeCols + j] = 0;
+                    }
                 }
-            } else {
-                if (currentG < data->G[(i + 1) * data->sizeCols + j - 1] || 
-                    currentG < data->G[(i - 1) * data->sizeCols + j + 1]) {
-                    data->G[i * data->sizeCols + j] = 0;
+                
+                (*data->outputPixels)[i * data->sizeCols + j] = 
+                    (int)(data->G[i * data->sizeCols + j] * (255.0 / largestG));
+            }
+        });
+    }
+    
+    return nullptr;
+}
+
+// Bound on the Sobel magnitude of every tile whose first row lies in
+// [startRow, endRow): |gx|, |gy| <= 4 r for a gray range r over the tile and
+// its one-pixel border, so G <= sqrt(32) r
+void* tileActivityWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    const int* p = data->inputPixels->data();
+    int sizeRows = data->sizeRows;
+    int sizeCols = data->sizeCols;
+    
+    for (int tr = (data->startRow + CANNY_TILE - 1) / CANNY_TILE; tr * CANNY_TILE < data->endRow; tr++) {
+        int i0 = std::max(0, tr * CANNY_TILE - 1);
+        int i1 = std::min(sizeRows, (tr + 1) * CANNY_TILE + 1);
+        for (int tc = 0; tc < data->tileCols; tc++) {
+            int j0 = std::max(0, tc * CANNY_TILE - 1);
+            int j1 = std::min(sizeCols, (tc + 1) * CANNY_TILE + 1);
+            int lo = p[i0 * sizeCols + j0];
+            int hi = lo;
+            for (int i = i0; i < i1; i++) {
+                for (int j = j0; j < j1; j++) {
+                    lo = std::min(lo, p[i * sizeCols + j]);
+                    hi = std::max(hi, p[i * sizeCols + j]);
                 }
             }
-            
-            (*data->outputPixels)[i * data->sizeCols + j] = 
-                (int)(data->G[i * data->sizeCols + j] * (255.0 / largestG));
+            double range = hi - lo;
+            data->tileBound[tr * data->tileCols + tc] = std::sqrt(32.0 * range * range);
         }
     }
-    
     return nullptr;
 }
 
 std::vector<int> cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
                                        double lowerThreshold, double higherThreshold) {
-    std::vector<int> pixelsCanny(sizeRows * sizeCols, 0);
-    double* G = new double[sizeRows * sizeCols]();
-    std::vector<int> theta(sizeRows * sizeCols, 0);
+    std::vector<int> theta;
+    std::vector<int> pixelsCanny;
+    if (g_precision != PRECISION_EXACT) {
+        std::vector<int> G;
+        cannyFilterFast_parallel(pixels, sizeRows, sizeCols, sizeDepth, lowerThreshold, higherThreshold, 
+                                 g_precision, G, theta, pixelsCanny);
+        return pixelsCanny;
+    }
+    std::vector<double> G;
+    cannyFilter_parallel(pixels, sizeRows, sizeCols, sizeDepth, lowerThreshold, higherThreshold, 
+                         G, theta, pixelsCanny);
+    return pixelsCanny;
+}
+
+// Phase 3: Double thresholding and hysteresis on the suppressed magnitudes
+void cannyHysteresis(double* G, int* pixelsCanny, int sizeRows, int sizeCols, 
+                     double lowerThreshold, double higherThreshold, double largestG, 
+                     const uint8_t* tileActive, int tileCols) {
+    HysteresisLimit limit = t_hysteresisLimit;
+    t_hysteresisOutcome = HYSTERESIS_COMPLETE;
+    int pass = 0;
+    bool changes;
+    do {
+        changes = false;
+        for (int i = 1; i < sizeRows - 1; i++) {
+            if (limit.deadlineMs > 0 && getCurrentTimeMs() >= limit.deadlineMs) {
+                if (pass > 0) {
+                    t_hysteresisOutcome = HYSTERESIS_BOUNDED;
+                    return;
+                }
+                // Out of time in the first pass: the remaining rows keep their strong pixels only
+                t_hysteresisOutcome = HYSTERESIS_ABANDONED;
+                for (; i < sizeRows - 1; i++) {
+                    forEachSpan(tileActive, tileCols, sizeCols, i, [&](int startCol, int endCol) {
+                        for (int j = startCol; j < endCol; j++) {
+                            if (G[i * sizeCols + j] < (higherThreshold * largestG)) {
+                                G[i * sizeCols + j] = 0;
+                                pixelsCanny[i * sizeCols + j] = 0;
+                            }
+                        }
+                    });
+                }
+                return;
+            }
+            forEachSpan(tileActive, tileCols, sizeCols, i, [&](int startCol, int endCol) {
+                for (int j = startCol; j < endCol; j++) {
+                    if (G[i * sizeCols + j] < (lowerThreshold * largestG)) {
+                        G[i * sizeCols + j] = 0;
+                    } else if (G[i * sizeCols + j] >= (higherThreshold * largestG)) {
+                        continue;
+                    } else {
+                        double tempG = G[i * sizeCols + j];
+                        G[i * sizeCols + j] = 0;
+                        for (int x = -1; x <= 1; x++) {
+                            bool breakLoop = false;
+                            for (int y = -1; y <= 1; y++) {
+                                if (x == 0 && y == 0) continue;
+                                if (G[(i + x) * sizeCols + (j + y)] >= (higherThreshold * largestG)) {
+                                    G[i * sizeCols + j] = higherThreshold * largestG;
+                                    changes = true;
+                                    breakLoop = true;
+                                    break;
+                                }
+                            }
+                            if (breakLoop) break;
+                        }
+                    }
+                    pixelsCanny[i * sizeCols + j] = (int)(G[i * sizeCols + j] * (255.0 / largestG));
+                }
+            });
+        }
+        pass++;
+        if (changes && limit.maxPasses > 0 && pass >= limit.maxPasses) {
+            t_hysteresisOutcome = HYSTERESIS_BOUNDED;
+            break;
+        }
+    } while (changes);
+}
+
+// Phase 1 of the flat-region skipping: the gradient of every tile that may
+// reach the low threshold. Tiles are first picked against the largest bound
+// (an upper bound of largestG), then against the largestG found, until no
+// tile is added; the skipped tiles' bounds stay below lowerThreshold *
+// largestG, so they cannot hold the maximum either. Leaves the mask of
+// computed tiles in the thread data for the later phases.
+static std::vector<uint8_t> sparseGradient(std::vector<ThreadData>& threadData, const StageBands& bands, 
+                                           int tileCols, double lowerThreshold, double& largestG) {
+    int sizeRows = threadData[0].sizeRows;
+    int numTiles = ((sizeRows + CANNY_TILE - 1) / CANNY_TILE) * tileCols;
+    std::vector<double> tileBound(numTiles, 0.0);
+    for (ThreadData& data : threadData) {
+        data.tileBound = tileBound.data();
+        data.tileCols = tileCols;
+    }
+    runThreads(tileActivityWorker, threadData.data(), bands.numBands, bands.numThreads);
+    
+    double largestBound = *std::max_element(tileBound.begin(), tileBound.end());
+    std::vector<uint8_t> tileActive(numTiles, 0);
+    std::vector<uint8_t> pending(numTiles, 0);
+    double limit = lowerThreshold * largestBound;
+    bool anyPending;
+    do {
+        anyPending = false;
+        for (int t = 0; t < numTiles; t++) {
+            pending[t] = !tileActive[t] && tileBound[t] >= limit;
+            anyPending = anyPending || pending[t];
+        }
+        if (anyPending) {
+            for (ThreadData& data : threadData) data.tileActive = pending.data();
+            runThreads(cannyPhase1Worker, threadData.data(), bands.numBands, bands.numThreads);
+            for (int t = 0; t < numTiles; t++) tileActive[t] |= pending[t];
+        }
+        limit = lowerThreshold * largestG;
+    } while (anyPending);
+    
+    t_tileStats.numTiles = numTiles;
+    t_tileStats.skippedTiles = (int)std::count(tileActive.begin(), tileActive.end(), 0);
+    for (ThreadData& data : threadData) {
+        data.tileActive = tileActive.data();
+        data.tileBound = nullptr;
+    }
+    return tileActive;
+}
+
+void cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                          double lowerThreshold, double higherThreshold, 
+                          std::vector<double>& gradient, std::vector<int>& theta, std::vector<int>& pixelsCanny) {
+    gradient.assign(sizeRows * sizeCols, 0.0);
+    theta.assign(sizeRows * sizeCols, 0);
+    double* G = gradient.data();
     double largestG = 0;
     
-    int numThreads = g_numThreads;
-    pthread_t threads[numThreads];
-    ThreadData threadData[numThreads];
+    StageBands bands = stageBands(STAGE_CANNY, sizeRows);
+    std::vector<ThreadData> threadData(bands.numBands);
     pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
     
-    int rowsPerThread = sizeRows / numThreads;
-    
     // Initialize thread data
-    for (int t = 0; t < numThreads; t++) {
+    for (int t = 0; t < bands.numBands; t++) {
         threadData[t].threadId = t;
-        threadData[t].numThreads = numThreads;
-        threadData[t].startRow = t * rowsPerThread;
-        threadData[t].endRow = (t == numThreads - 1) ? sizeRows : (t + 1) * rowsPerThread;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
         threadData[t].sizeRows = sizeRows;
         threadData[t].sizeCols = sizeCols;
         threadData[t].sizeDepth = sizeDepth;
@@ -259,13 +768,20 @@ std::vector<int> cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, in
     }
     
     // Phase 1: Compute gradients (parallel)
-    for (int t = 0; t < numThreads; t++) {
-        pthread_create(&threads[t], nullptr, cannyPhase1Worker, &threadData[t]);
-    }
-    for (int t = 0; t < numThreads; t++) {
-        pthread_join(threads[t], nullptr);
+    int tileCols = (sizeCols + CANNY_TILE - 1) / CANNY_TILE;
+    std::vector<uint8_t> tileActive;
+    bool skipFlat = g_sparsityMode == SPARSITY_SKIP_FLAT && lowerThreshold > 0;
+    if (skipFlat) {
+        tileActive = sparseGradient(threadData, bands, tileCols, lowerThreshold, largestG);
+    } else {
+        t_tileStats.numTiles = ((sizeRows + CANNY_TILE - 1) / CANNY_TILE) * tileCols;
+        t_tileStats.skippedTiles = 0;
+        runThreads(cannyPhase1Worker, threadData.data(), bands.numBands, bands.numThreads);
     }
     
+    // The input is not read after phase 1, so pixelsCanny may share its buffer
+    pixelsCanny.assign(sizeRows * sizeCols, 0);
+    
     // Handle edge pixels (copy from neighbors) - single thread
     for (int j = 1; j < sizeCols - 1; j++) {
         G[j] = G[sizeCols + j];
@@ -281,49 +797,238 @@ std::vector<int> cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, in
     }
     
     // Phase 2: Non-maximum suppression (parallel)
-    for (int t = 0; t < numThreads; t++) {
-        pthread_create(&threads[t], nullptr, cannyPhase2Worker, &threadData[t]);
+    runThreads(cannyPhase2Worker, threadData.data(), bands.numBands, bands.numThreads);
+    
+    // Phase 3: Double thresholding (sequential due to dependencies)
+    cannyHysteresis(G, pixelsCanny.data(), sizeRows, sizeCols, lowerThreshold, higherThreshold, largestG, 
+                    skipFlat ? tileActive.data() : nullptr, tileCols);
+    
+    pthread_mutex_destroy(&mutex);
+}
+
+// ============================================================================
+// CANNY FILTER - FAST (INTEGER) PRECISION MODES
+// ============================================================================
+
+// Direction bucket of the exact mode, (int)(180 + atan2(gy, gx) in degrees) / 45 * 45,
+// derived from the signs of gx/gy and |gx| vs |gy| only. The exact mode's
+// truncated pi puts angles of -45, -90 and -135 degrees just below their
+// bucket boundary, which the strict comparisons for gy < 0 reproduce.
+static inline int quantizeDirection(int gxValue, int gyValue) {
+    int ax = std::abs(gxValue);
+    int ay = std::abs(gyValue);
+    int k;
+    if (gyValue == 0) {
+        k = (gxValue >= 0) ? 4 : 8;
+    } else if (gyValue > 0) {
+        if (gxValue > 0) k = (ay < ax) ? 4 : 5;
+        else if (gxValue == 0) k = 6;
+        else k = (ay > ax) ? 6 : 7;
+    } else {
+        if (gxValue > 0) k = (ay < ax) ? 3 : 2;
+        else if (gxValue == 0) k = 1;
+        else k = (ay > ax) ? 1 : 0;
     }
-    for (int t = 0; t < numThreads; t++) {
-        pthread_join(threads[t], nullptr);
+    return k * 45;
+}
+
+// Phase 1 (fast): integer Sobel, L1 or squared L2 magnitude
+void* cannyPhase1FastWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    const int* p = data->inputPixels->data();
+    int* theta = data->theta->data();
+    int cols = data->sizeCols;
+    bool l1 = data->precision == PRECISION_FAST_L1;
+
+    int localLargestG = 0;
+    int startRow = std::max(1, data->startRow);
+    int endRow = std::min(data->sizeRows - 1, data->endRow);
+
+    for (int i = startRow; i < endRow; i++) {
+        const int* up = p + (i - 1) * cols;
+        const int* mid = p + i * cols;
+        const int* down = p + (i + 1) * cols;
+        for (int j = 1; j < cols - 1; j++) {
+            // Same orientation as the exact kernels: gx = left - right, gy = top - bottom
+            int gxValue = (up[j - 1] + 2 * mid[j - 1] + down[j - 1]) - (up[j + 1] + 2 * mid[j + 1] + down[j + 1]);
+            int gyValue = (up[j - 1] + 2 * up[j] + up[j + 1]) - (down[j - 1] + 2 * down[j] + down[j + 1]);
+            int g = l1 ? std::abs(gxValue) + std::abs(gyValue) : gxValue * gxValue + gyValue * gyValue;
+
+            data->Gi[i * cols + j] = g;
+            theta[i * cols + j] = quantizeDirection(gxValue, gyValue);
+            if (g > localLargestG) localLargestG = g;
+        }
     }
-    
+
+    pthread_mutex_lock(data->mutex);
+    if (localLargestG > *(data->largestGi)) {
+        *(data->largestGi) = localLargestG;
+    }
+    pthread_mutex_unlock(data->mutex);
+
+    return nullptr;
+}
+
+// Phase 2 (fast): non-maximum suppression on integer magnitudes. The squared
+// L2 magnitude orders pixels like the true one, so its comparisons match the
+// exact mode; L1 does not ((3, 0) gives 3 < 4 for (2, 2), but 3 > 2.83), so
+// fast-l1 may keep or suppress different pixels.
+void* cannyPhase2FastWorker(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    int* G = data->Gi;
+    const int* theta = data->theta->data();
+    int cols = data->sizeCols;
+
+    int startRow = std::max(1, data->startRow);
+    int endRow = std::min(data->sizeRows - 1, data->endRow);
+
+    for (int i = startRow; i < endRow; i++) {
+        for (int j = 1; j < cols - 1; j++) {
+            int t = theta[i * cols + j];
+            int currentG = G[i * cols + j];
+            int a, b;
+            if (t == 0 || t == 180) {
+                a = G[i * cols + j - 1];
+                b = G[i * cols + j + 1];
+            } else if (t == 45 || t == 225) {
+                a = G[(i + 1) * cols + j + 1];
+                b = G[(i - 1) * cols + j - 1];
+            } else if (t == 90 || t == 270) {
+                a = G[(i + 1) * cols + j];
+                b = G[(i - 1) * cols + j];
+            } else {
+                a = G[(i + 1) * cols + j - 1];
+                b = G[(i - 1) * cols + j + 1];
+            }
+            if (currentG < a || currentG < b) {
+                G[i * cols + j] = 0;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void cannyFilterFast_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                              double lowerThreshold, double higherThreshold, CannyPrecision precision, 
+                              std::vector<int>& gradient, std::vector<int>& theta, std::vector<int>& pixelsCanny) {
+    gradient.assign(sizeRows * sizeCols, 0);
+    theta.assign(sizeRows * sizeCols, 0);
+    int* G = gradient.data();
+    int largestG = 0;
+
+    StageBands bands = stageBands(STAGE_CANNY, sizeRows);
+    std::vector<ThreadData> threadData(bands.numBands);
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    for (int t = 0; t < bands.numBands; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numThreads = bands.numBands;
+        setBandRows(threadData[t], bands, t, sizeRows);
+        threadData[t].sizeRows = sizeRows;
+        threadData[t].sizeCols = sizeCols;
+        threadData[t].sizeDepth = sizeDepth;
+        threadData[t].inputPixels = &pixels;
+        threadData[t].outputPixels = &pixelsCanny;
+        threadData[t].theta = &theta;
+        threadData[t].Gi = G;
+        threadData[t].largestGi = &largestG;
+        threadData[t].precision = precision;
+        threadData[t].mutex = &mutex;
+    }
+
+    // Phase 1: Compute gradients (parallel)
+    runThreads(cannyPhase1FastWorker, threadData.data(), bands.numBands, bands.numThreads);
+
+    // The input is not read after phase 1, so pixelsCanny may share its buffer
+    pixelsCanny.assign(sizeRows * sizeCols, 0);
+
+    // Handle edge pixels (copy from neighbors) - single thread
+    for (int j = 1; j < sizeCols - 1; j++) {
+        G[j] = G[sizeCols + j];
+        theta[j] = theta[sizeCols + j];
+        G[(sizeRows - 1) * sizeCols + j] = G[(sizeRows - 2) * sizeCols + j];
+        theta[(sizeRows - 1) * sizeCols + j] = theta[(sizeRows - 2) * sizeCols + j];
+    }
+    for (int i = 0; i < sizeRows; i++) {
+        G[i * sizeCols] = G[i * sizeCols + 1];
+        theta[i * sizeCols] = theta[i * sizeCols + 1];
+        G[i * sizeCols + sizeCols - 1] = G[i * sizeCols + sizeCols - 2];
+        theta[i * sizeCols + sizeCols - 1] = theta[i * sizeCols + sizeCols - 2];
+    }
+
+    // Phase 2: Non-maximum suppression (parallel)
+    runThreads(cannyPhase2FastWorker, threadData.data(), bands.numBands, bands.numThreads);
+
+    pthread_mutex_destroy(&mutex);
+    t_hysteresisOutcome = HYSTERESIS_COMPLETE;
+    if (largestG == 0) return;
+
+    // Integer thresholds: for integer g, g < x  <=>  g < ceil(x). The squared
+    // mode compares against squared thresholds.
+    bool l1 = precision == PRECISION_FAST_L1;
+    int lowG = (int)std::ceil(l1 ? lowerThreshold * largestG : lowerThreshold * lowerThreshold * largestG);
+    int highG = (int)std::ceil(l1 ? higherThreshold * largestG : higherThreshold * higherThreshold * largestG);
+
+    // Output level of a kept magnitude
+    auto scaled = [&](int g) {
+        if (l1) return (int)((long long)g * 255 / largestG);
+        return (int)(std::sqrt((double)g / largestG) * 255.0);
+    };
+
     // Phase 3: Double thresholding (sequential due to dependencies)
+    HysteresisLimit limit = t_hysteresisLimit;
+    int pass = 0;
     bool changes;
     do {
         changes = false;
         for (int i = 1; i < sizeRows - 1; i++) {
+            if (limit.deadlineMs > 0 && getCurrentTimeMs() >= limit.deadlineMs) {
+                if (pass > 0) {
+                    t_hysteresisOutcome = HYSTERESIS_BOUNDED;
+                    return;
+                }
+                // Out of time in the first pass: the remaining rows keep their strong pixels only
+                t_hysteresisOutcome = HYSTERESIS_ABANDONED;
+                for (; i < sizeRows - 1; i++) {
+                    for (int j = 1; j < sizeCols - 1; j++) {
+                        // NMS leaves pixelsCanny at 0 in the fast modes
+                        if (G[i * sizeCols + j] < highG) {
+                            G[i * sizeCols + j] = 0;
+                            pixelsCanny[i * sizeCols + j] = 0;
+                        } else {
+                            pixelsCanny[i * sizeCols + j] = scaled(G[i * sizeCols + j]);
+                        }
+                    }
+                }
+                return;
+            }
             for (int j = 1; j < sizeCols - 1; j++) {
-                if (G[i * sizeCols + j] < (lowerThreshold * largestG)) {
-                    G[i * sizeCols + j] = 0;
-                } else if (G[i * sizeCols + j] >= (higherThreshold * largestG)) {
-                    continue;
-                } else {
-                    double tempG = G[i * sizeCols + j];
-                    G[i * sizeCols + j] = 0;
-                    for (int x = -1; x <= 1; x++) {
-                        bool breakLoop = false;
+                int& g = G[i * sizeCols + j];
+                if (g < lowG) {
+                    g = 0;
+                } else if (g < highG) {
+                    g = 0;
+                    for (int x = -1; x <= 1 && g == 0; x++) {
                         for (int y = -1; y <= 1; y++) {
                             if (x == 0 && y == 0) continue;
-                            if (G[(i + x) * sizeCols + (j + y)] >= (higherThreshold * largestG)) {
-                                G[i * sizeCols + j] = higherThreshold * largestG;
+                            if (G[(i + x) * sizeCols + (j + y)] >= highG) {
+                                g = highG;
                                 changes = true;
-                                breakLoop = true;
                                 break;
                             }
                         }
-                        if (breakLoop) break;
                     }
                 }
-                pixelsCanny[i * sizeCols + j] = (int)(G[i * sizeCols + j] * (255.0 / largestG));
+                pixelsCanny[i * sizeCols + j] = g == 0 ? 0 : scaled(g);
             }
         }
+        pass++;
+        if (changes && limit.maxPasses > 0 && pass >= limit.maxPasses) {
+            t_hysteresisOutcome = HYSTERESIS_BOUNDED;
+            break;
+        }
     } while (changes);
-    
-    delete[] G;
-    pthread_mutex_destroy(&mutex);
-    
-    return pixelsCanny;
 }
 
 // ============================================================================
@@ -342,31 +1047,121 @@ void cannyEdgeDetection_parallel(std::string readLocation, std::string writeLoca
         return;
     }
 
-    uint8_t* pixelPtr = (uint8_t*)img.data;
+    CannyWorkspace ws;
+    cannyEdgeDetection_parallel(img, ws, lowerThreshold, higherThreshold);
+
+    // Write output
+    cv::Mat imgGrayscale(img.rows, img.cols, CV_8UC1, cv::Scalar(0));
+    uint8_t* pixelPtrGray = (uint8_t*)imgGrayscale.data;
+    arrayToImg(ws.pixelsCanny, pixelPtrGray, img.rows, img.cols, 1);
+
+    cv::imwrite(writeLocation, imgGrayscale);
+}
+
+size_t workspaceBytes(const CannyWorkspace& ws) {
+    return (ws.pixels.capacity() + ws.pixelsBlur.capacity() + ws.pixelsGray.capacity() + 
+            ws.Gfast.capacity() + ws.theta.capacity() + ws.pixelsCanny.capacity()) * sizeof(int) + 
+           ws.G.capacity() * sizeof(double);
+}
+
+template <typename T>
+static void releaseBuffer(std::vector<T>& buffer) {
+    std::vector<T>().swap(buffer);
+}
+
+void cannyEdgeDetection_parallel(const cv::Mat& img, CannyWorkspace& ws, 
+                                  double lowerThreshold, double higherThreshold) {
+    const uint8_t* pixelPtr = (const uint8_t*)img.data;
     int sizeRows = img.rows;
     int sizeCols = img.cols;
     int sizeDepth = img.channels();
-    std::vector<int> pixels = imgToArray(img, pixelPtr, sizeRows, sizeCols, sizeDepth);
 
-    // Gaussian blur - parallel
-    std::vector<std::vector<double>> kernel = {{2.0, 4.0, 5.0, 4.0, 2.0},
-                                               {4.0, 9.0, 12.0, 9.0, 4.0},
-                                               {5.0, 12.0, 15.0, 12.0, 5.0},
-                                               {4.0, 9.0, 12.0, 9.0, 4.0},
-                                               {2.0, 4.0, 5.0, 4.0, 2.0}};
-    double kernelConst = (1.0 / 159.0);
-    std::vector<int> pixelsBlur = gaussianBlur_parallel(pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth);
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+
+    if (getAutoTune()) {
+        applyAutoTuning(img, ws, lowerThreshold, higherThreshold);
+    }
 
-    // RGB to Grayscale - parallel
-    std::vector<int> pixelsGray = rgbToGrayscale_parallel(pixelsBlur, sizeRows, sizeCols, sizeDepth);
+    bool lowMemory = g_memoryMode == MEMORY_LOW;
+    if (lowMemory) {
+        // Only the previous edge map survives a low-memory run; reuse it as
+        // the blur buffer, which becomes this run's edge map in turn
+        ws.pixelsBlur.swap(ws.pixelsCanny);
+        releaseBuffer(ws.pixels);
+        releaseBuffer(ws.pixelsGray);
+        releaseBuffer(ws.pixelsCanny);
+        releaseBuffer(ws.G);
+        releaseBuffer(ws.Gfast);
+        releaseBuffer(ws.theta);
+    }
 
-    // Canny filter - parallel
-    std::vector<int> pixelsCanny = cannyFilter_parallel(pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold);
+    // Account the buffers a stage added, before its inputs are released
+    size_t held = workspaceBytes(ws);
+    ws.peakBytes = held;
+    auto account = [&](CannyStage stage) {
+        size_t now = workspaceBytes(ws);
+        ws.stageBytes[stage] = now > held ? now - held : 0;
+        ws.peakBytes = std::max(ws.peakBytes, now);
+        held = now;
+    };
+    // The low-memory plan frees the image copy once the blur has consumed it
+    auto releaseInput = [&]() {
+        if (!lowMemory) return;
+        releaseBuffer(ws.pixels);
+        held = workspaceBytes(ws);
+    };
 
-    // Write output
-    cv::Mat imgGrayscale(sizeRows, sizeCols, CV_8UC1, cv::Scalar(0));
-    uint8_t* pixelPtrGray = (uint8_t*)imgGrayscale.data;
-    arrayToImg(pixelsCanny, pixelPtrGray, sizeRows, sizeCols, 1);
+    // In the low-memory plan the gray image lives in pixelsBlur
+    std::vector<int>& pixelsGray = lowMemory ? ws.pixelsBlur : ws.pixelsGray;
 
-    cv::imwrite(writeLocation, imgGrayscale);
+    if (g_pipelineMode != PIPELINE_CHANNEL_FIRST) {
+        // Grayscale while reading, then a single-channel blur - parallel
+        lumaBlur_parallel(img, g_pipelineMode, kernel, kernelConst, ws.pixels, ws.pixelsBlur, pixelsGray);
+        account(STAGE_BLUR);
+        ws.stageBytes[STAGE_GRAY] = 0;
+        releaseInput();
+    } else {
+        // Same conversion as imgToArray, but into the reused buffer
+        ws.pixels.resize(sizeRows * sizeCols * sizeDepth);
+        for (int i = 0; i < sizeRows * sizeCols; i++) {
+            for (int k = 0; k < sizeDepth; k++) {
+                ws.pixels[i * sizeDepth + k] = (int)pixelPtr[i * sizeDepth + sizeDepth - 1 - k];
+            }
+        }
+
+        // Gaussian blur - parallel
+        gaussianBlur_parallel(ws.pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, ws.pixelsBlur);
+        account(STAGE_BLUR);
+
+        releaseInput();
+
+        // RGB to Grayscale - parallel
+        if (lowMemory) {
+            rgbToGrayscaleInPlace_parallel(ws.pixelsBlur, sizeRows, sizeCols, sizeDepth);
+        } else {
+            rgbToGrayscale_parallel(ws.pixelsBlur, sizeRows, sizeCols, sizeDepth, ws.pixelsGray);
+        }
+        account(STAGE_GRAY);
+    }
+
+    // Canny filter - parallel. The low-memory plan writes the edge map over
+    // the gray image.
+    std::vector<int>& pixelsCanny = lowMemory ? ws.pixelsBlur : ws.pixelsCanny;
+    if (g_precision != PRECISION_EXACT) {
+        cannyFilterFast_parallel(pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold, 
+                                 g_precision, ws.Gfast, ws.theta, pixelsCanny);
+    } else {
+        cannyFilter_parallel(pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold, 
+                             ws.G, ws.theta, pixelsCanny);
+    }
+    account(STAGE_CANNY);
+
+    if (lowMemory) {
+        ws.pixelsCanny.swap(ws.pixelsBlur);
+        releaseBuffer(ws.G);
+        releaseBuffer(ws.Gfast);
+        releaseBuffer(ws.theta);
+    }
 }
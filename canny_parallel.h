@@ -8,7 +8,13 @@
 
 #include <opencv2/highgui.hpp>
 
+#include "canny_backend.h"
+
 // Thread data structure for passing parameters
+// Most channels the luma-first pipeline weights directly (BGRA); deeper
+// images take the channel-first path inside lumaBlur_parallel
+const int LUMA_MAX_CHANNELS = 4;
+
 struct ThreadData {
     int threadId;
     int numThreads;
@@ -27,14 +33,181 @@ struct ThreadData {
     double lowerThreshold;
     double higherThreshold;
     double* largestG;
+    // For the fast precision modes
+    int* Gi;
+    int* largestGi;
+    int precision;
+    // For the luma-first pipeline
+    const uint8_t* imagePixels;
+    int grayWeights[LUMA_MAX_CHANNELS];  // B, G, R(, A) weights applied while reading the image
+    int grayDivisor;
+    // For flat-region skipping: active tiles (nullptr = all) and tile bounds
+    const uint8_t* tileActive;
+    double* tileBound;
+    int tileCols;
     pthread_mutex_t* mutex;
     pthread_barrier_t* barrier;
 };
 
+// Gradient magnitude used by cannyFilter. The fast modes work on integers
+// throughout gradient, NMS and thresholding and skip atan2; the direction is
+// quantized from the signs and relative size of gx and gy instead. fast-l2sq
+// orders magnitudes like the exact mode; fast-l1 overestimates diagonal
+// gradients by up to sqrt(2), so its NMS and thresholds are approximate.
+enum CannyPrecision {
+    PRECISION_EXACT,     // sqrt(gx^2 + gy^2) in double (default)
+    PRECISION_FAST_L1,   // |gx| + |gy| in int, approximate NMS and thresholds
+    PRECISION_FAST_L2SQ, // gx^2 + gy^2 in int, thresholds squared
+};
+
+// Order of blur and grayscale conversion. Both are linear, so converting to
+// gray while reading the image and blurring one channel gives the same
+// result up to integer rounding (at most one gray level) at a third of the
+// blur cost. The weighted sum is kept unscaled through the blur and divided
+// afterwards so no extra rounding is introduced before blurring.
+enum PipelineMode {
+    PIPELINE_CHANNEL_FIRST,  // blur B, G, R, then average (default)
+    PIPELINE_LUMA_AVERAGE,   // (B + G + R) / 3 first, then blur
+    PIPELINE_LUMA_BT601,     // (29 B + 150 G + 77 R) / 256 first, then blur
+};
+
+// Buffer schedule of cannyEdgeDetection_parallel(img, ws). The default keeps
+// every intermediate buffer in the workspace (about 44 bytes per pixel for a
+// BGR image). The low-memory plan frees each stage's input once it is
+// consumed, converts to gray in place and lets cannyFilter write its output
+// over its input, so at most two large buffers are held at any time and only
+// the edge map stays in the workspace between runs. The output is identical.
+enum MemoryMode {
+    MEMORY_DEFAULT,  // keep all buffers for reuse (fastest for repeated calls)
+    MEMORY_LOW,      // ping-pong buffers, in-place gray, free consumed inputs
+};
+
+// Flat-region skipping in the exact cannyFilter. The image is split into
+// CANNY_TILE x CANNY_TILE tiles. No Sobel magnitude in a tile exceeds
+// sqrt(32) times the gray range over the tile and its one-pixel border, so
+// when that bound is below the low threshold the whole tile ends up 0 and
+// cannot change an NMS or hysteresis decision elsewhere. Such tiles skip the
+// gradient, NMS and hysteresis work; the output is identical.
+enum SparsityMode {
+    SPARSITY_DENSE,      // visit every pixel (default)
+    SPARSITY_SKIP_FLAT,  // skip tiles that cannot reach the low threshold
+};
+
+const int CANNY_TILE = 32;
+
+struct TileStats {
+    int numTiles;
+    int skippedTiles;
+};
+
+// Bounds on the hysteresis passes of cannyFilter. Hysteresis repeats full
+// passes until no pixel changes, so its time is data dependent. With a
+// deadline, a first pass that runs out of time keeps only the strong pixels
+// in the rows it did not reach; later passes are simply cut.
+struct HysteresisLimit {
+    int maxPasses;      // 0: until no pixel changes
+    double deadlineMs;  // getCurrentTimeMs() value to stop at, 0: none
+};
+
+enum HysteresisOutcome {
+    HYSTERESIS_COMPLETE,   // ran until no pixel changed
+    HYSTERESIS_BOUNDED,    // every pixel thresholded, propagation cut short
+    HYSTERESIS_ABANDONED,  // deadline hit in the first pass, rest strong-only
+};
+
+// Execution settings for each parallel stage, chosen by hand or by the
+// auto-tuner (canny_tuning.h). None of them change the output.
+enum CannyStage {
+    STAGE_BLUR,   // gaussianBlur_parallel
+    STAGE_GRAY,   // rgbToGrayscale_parallel, luma conversion
+    STAGE_CANNY,  // gradient and NMS phases of cannyFilter
+    NUM_STAGES,
+};
+
+// Output-identical implementations of the blur, picked per thread like the
+// stage settings
+enum BlurKernel {
+    BLUR_KERNEL_GENERIC,   // bounds checks on every tap
+    BLUR_KERNEL_INTERIOR,  // no bounds checks two or more pixels from the border
+};
+
+// Zero fields mean the defaults: getNumThreads() threads, one band per thread.
+// numThreads is capped by getNumThreads().
+struct StageConfig {
+    int numThreads;
+    int chunkRows;
+};
+
+struct TuningConfig {
+    StageConfig stages[NUM_STAGES];
+    BlurKernel blurKernel;
+};
+
+// Reusable buffers for one pipeline run. The vectors keep their capacity
+// between calls, so a long-lived caller only allocates when images grow.
+struct CannyWorkspace {
+    std::vector<int> pixels;
+    std::vector<int> pixelsBlur;
+    std::vector<int> pixelsGray;
+    std::vector<double> G;
+    std::vector<int> Gfast;
+    std::vector<int> theta;
+    std::vector<int> pixelsCanny;
+
+    // Memory accounting of the last run, in bytes of buffer capacity.
+    // Loading the image counts as blur; in the luma pipelines the fused
+    // conversion and blur count as blur too.
+    size_t stageBytes[NUM_STAGES] = {};  // added to the workspace by each stage
+    size_t peakBytes = 0;                // most held at once during the run
+};
+
+// Bytes currently held by the workspace buffers
+size_t workspaceBytes(const CannyWorkspace& ws);
+
 // Global thread count setter
 void setNumThreads(int n);
 int getNumThreads();
 
+// Override the thread count for parallel calls made from the current thread
+// only (n <= 0 clears it). Used to run several pipelines side by side.
+void setThreadLocalNumThreads(int n);
+
+// Stage settings for parallel calls made from the current thread
+void setTuningConfig(const TuningConfig& config);
+TuningConfig getTuningConfig();
+
+// Global precision mode, PRECISION_EXACT unless changed
+void setPrecisionMode(CannyPrecision precision);
+CannyPrecision getPrecisionMode();
+const char* precisionModeName(CannyPrecision precision);
+
+// Global pipeline mode, PIPELINE_CHANNEL_FIRST unless changed
+void setPipelineMode(PipelineMode mode);
+PipelineMode getPipelineMode();
+const char* pipelineModeName(PipelineMode mode);
+
+// Global memory mode, MEMORY_DEFAULT unless changed
+void setMemoryMode(MemoryMode mode);
+MemoryMode getMemoryMode();
+const char* memoryModeName(MemoryMode mode);
+
+// Global sparsity mode, SPARSITY_DENSE unless changed. Only the exact
+// precision mode skips tiles.
+void setSparsityMode(SparsityMode mode);
+SparsityMode getSparsityMode();
+const char* sparsityModeName(SparsityMode mode);
+
+// Tiles of the last exact cannyFilter_parallel call made from this thread
+TileStats getLastTileStats();
+
+// Hysteresis bounds for cannyFilter calls made from the current thread (none
+// unless set), and how the last hysteresis run on this thread ended
+void setHysteresisLimit(const HysteresisLimit& limit);
+HysteresisLimit getHysteresisLimit();
+HysteresisOutcome getLastHysteresisOutcome();
+const char* hysteresisOutcomeName(HysteresisOutcome outcome);
+
+
 // Parallel versions of the main functions
 std::vector<int> gaussianBlur_parallel(std::vector<int>& pixels, std::vector<std::vector<double>>& kernel, 
                                         double kernelConst, int sizeRows, int sizeCols, int sizeDepth);
@@ -42,9 +215,62 @@ std::vector<int> rgbToGrayscale_parallel(std::vector<int>& pixels, int sizeRows,
 std::vector<int> cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
                                        double lowerThreshold, double higherThreshold);
 
+// Luma-first blur: gray conversion fused into reading the BGR image, then a
+// single-channel blur. pixelsLuma receives the unscaled weighted sums,
+// pixelsBlur their blur and pixelsGray the final gray image. pixelsGray may
+// be the same vector as pixelsBlur. Gray, BGR and BGRA images are weighted
+// directly (BT.601 ignores alpha); deeper images are blurred per channel.
+void lumaBlur_parallel(const cv::Mat& img, PipelineMode mode, std::vector<std::vector<double>>& kernel, 
+                       double kernelConst, std::vector<int>& pixelsLuma, std::vector<int>& pixelsBlur, 
+                       std::vector<int>& pixelsGray);
+
+// Same as above, but writing into caller-owned buffers. The double G overload
+// of cannyFilter_parallel always uses PRECISION_EXACT. pixels and pixelsCanny
+// of the cannyFilter overloads may be the same vector: the input is only read
+// by the gradient phase, before the output is written.
+void gaussianBlur_parallel(std::vector<int>& pixels, std::vector<std::vector<double>>& kernel, 
+                           double kernelConst, int sizeRows, int sizeCols, int sizeDepth, 
+                           std::vector<int>& pixelsBlur);
+void rgbToGrayscale_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                             std::vector<int>& pixelsGray);
+
+// Grayscale conversion overwriting its input; pixels ends up with
+// sizeRows * sizeCols values (its capacity is kept)
+void rgbToGrayscaleInPlace_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth);
+void cannyFilter_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                          double lowerThreshold, double higherThreshold, 
+                          std::vector<double>& G, std::vector<int>& theta, std::vector<int>& pixelsCanny);
+void cannyFilterFast_parallel(std::vector<int>& pixels, int sizeRows, int sizeCols, int sizeDepth, 
+                              double lowerThreshold, double higherThreshold, CannyPrecision precision, 
+                              std::vector<int>& G, std::vector<int>& theta, std::vector<int>& pixelsCanny);
+
+// The 5x5 Gaussian kernel of the pipeline (same as canny.cpp) and its
+// normalization constant
+void makeGaussianKernel(std::vector<std::vector<double>>& kernel, double& kernelConst);
+
+// One blurred value (row i, column j, channel k) of the ThreadData's input,
+// with the kernel renormalized at the image border. Every blur uses the same
+// per-pixel definition.
+int blurPixel(const ThreadData* data, int i, int j, int k);
+
+// Individual phases of the exact cannyFilter_parallel, exposed for the
+// microbenchmarks. The workers process rows [startRow, endRow) of one
+// ThreadData (only the active tiles when tileActive is set); cannyHysteresis
+// is the sequential thresholding pass.
+void* cannyPhase1Worker(void* arg);  // Sobel magnitude and direction
+void* cannyPhase2Worker(void* arg);  // non-maximum suppression
+void cannyHysteresis(double* G, int* pixelsCanny, int sizeRows, int sizeCols, 
+                     double lowerThreshold, double higherThreshold, double largestG, 
+                     const uint8_t* tileActive = nullptr, int tileCols = 0);
+
 // Parallel version of the main canny edge detection function
 void cannyEdgeDetection_parallel(std::string readLocation, std::string writeLocation, 
                                   double lowerThreshold, double higherThreshold);
 
+// Run the pipeline on an already decoded BGR image. The edge map is left in
+// ws.pixelsCanny (sizeRows * sizeCols values in 0..255).
+void cannyEdgeDetection_parallel(const cv::Mat& img, CannyWorkspace& ws, 
+                                  double lowerThreshold, double higherThreshold);
+
 // Benchmark utilities
 double getCurrentTimeMs();
@@ -0,0 +1,489 @@
+#include "canny_shard.h"
+#include "canny.h"
+#include "canny_parallel.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// Control block at the start of the segment
+struct ShardControl {
+    int sizeRows;
+    int sizeCols;
+    int sizeDepth;
+    int numShards;
+    double lowerThreshold;
+    double higherThreshold;
+    pthread_barrier_t barrier;
+    // Posted by shard s - 1 once its last row is final after NMS / hysteresis
+    sem_t nmsReady[MAX_SHARDS];
+    sem_t hysteresisReady[MAX_SHARDS];
+    double largestG[MAX_SHARDS];
+    int nmsRowsPatched[MAX_SHARDS];
+    int hysteresisPatched[MAX_SHARDS];
+};
+
+// Boundary rows each shard publishes, sizeCols doubles each
+enum HaloSlot {
+    HALO_GRAY_FIRST,
+    HALO_GRAY_LAST,
+    HALO_G_FIRST,           // gradient before NMS
+    HALO_G_LAST,
+    HALO_NMS_FIRST,         // after the NMS seam pass
+    HALO_NMS_LAST,
+    HALO_HYSTERESIS_LAST,   // after the hysteresis seam pass
+    NUM_HALO_SLOTS,
+};
+
+struct SegmentLayout {
+    size_t input;
+    size_t edges;
+    size_t halo;
+    size_t size;
+};
+
+static size_t alignUp(size_t bytes) {
+    return (bytes + 63) & ~(size_t)63;
+}
+
+static SegmentLayout segmentLayout(int sizeRows, int sizeCols, int sizeDepth, int numShards) {
+    SegmentLayout layout;
+    layout.input = alignUp(sizeof(ShardControl));
+    layout.edges = layout.input + alignUp((size_t)sizeRows * sizeCols * sizeDepth);
+    layout.halo = layout.edges + alignUp((size_t)sizeRows * sizeCols);
+    layout.size = layout.halo + (size_t)numShards * NUM_HALO_SLOTS * sizeCols * sizeof(double);
+    return layout;
+}
+
+static double* haloRow(const ShardSegment& segment, int shard, HaloSlot slot) {
+    ShardControl* control = (ShardControl*)segment.data;
+    SegmentLayout layout = segmentLayout(control->sizeRows, control->sizeCols, control->sizeDepth, control->numShards);
+    return (double*)(segment.data + layout.halo) + ((size_t)shard * NUM_HALO_SLOTS + slot) * control->sizeCols;
+}
+
+// Same split as the thread bands: equal shards, the last one takes the rest
+static void shardRows(int sizeRows, int numShards, int shard, int& startRow, int& endRow) {
+    int rowsPerShard = sizeRows / numShards;
+    startRow = shard * rowsPerShard;
+    endRow = (shard == numShards - 1) ? sizeRows : startRow + rowsPerShard;
+}
+
+template <typename From, typename To>
+static void copyRow(const From* from, To* to, int sizeCols) {
+    for (int j = 0; j < sizeCols; j++) {
+        to[j] = (To)from[j];
+    }
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+// Runs in the forked worker process. Local buffers hold the shard's rows at
+// local rows 1..n with the neighbours' boundary rows at 0 and n + 1.
+static int shardWorker(ShardSegment& segment, int shard) {
+    ShardControl* control = (ShardControl*)segment.data;
+    int sizeRows = control->sizeRows;
+    int sizeCols = control->sizeCols;
+    int sizeDepth = control->sizeDepth;
+    int numShards = control->numShards;
+    double lowerThreshold = control->lowerThreshold;
+    double higherThreshold = control->higherThreshold;
+
+    int startRow, endRow;
+    shardRows(sizeRows, numShards, shard, startRow, endRow);
+    int n = endRow - startRow;
+    int localRows = n + 2;
+    bool first = shard == 0;
+    bool last = shard == numShards - 1;
+    // Local rows that go through Sobel, NMS and hysteresis (the image's first
+    // and last rows are border copies)
+    int firstRow = first ? 2 : 1;
+    int lastRow = last ? n : n + 1;
+
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+
+    // Blur and gray: the 5x5 blur of rows [startRow, endRow) only needs the
+    // two input rows on either side, which are read from the shared input
+    int inStart = std::max(0, startRow - 2);
+    int inEnd = std::min(sizeRows, endRow + 2);
+    std::vector<int> pixels = imgToArray(segment.input, segment.input.ptr(inStart), inEnd - inStart,
+                                         sizeCols, sizeDepth);
+    std::vector<int> pixelsBlur;
+    gaussianBlur_parallel(pixels, kernel, kernelConst, inEnd - inStart, sizeCols, sizeDepth, pixelsBlur);
+    std::vector<int>().swap(pixels);
+    rgbToGrayscaleInPlace_parallel(pixelsBlur, inEnd - inStart, sizeCols, sizeDepth);
+
+    std::vector<int> gray(localRows * sizeCols, 0);
+    std::copy(pixelsBlur.begin() + (startRow - inStart) * sizeCols,
+              pixelsBlur.begin() + (endRow - inStart) * sizeCols, gray.begin() + sizeCols);
+    std::vector<int>().swap(pixelsBlur);
+
+    // Exchange gray boundary rows for the Sobel stencil
+    copyRow(&gray[sizeCols], haloRow(segment, shard, HALO_GRAY_FIRST), sizeCols);
+    copyRow(&gray[n * sizeCols], haloRow(segment, shard, HALO_GRAY_LAST), sizeCols);
+    pthread_barrier_wait(&control->barrier);
+    if (!first) copyRow(haloRow(segment, shard - 1, HALO_GRAY_LAST), &gray[0], sizeCols);
+    if (!last) copyRow(haloRow(segment, shard + 1, HALO_GRAY_FIRST), &gray[(n + 1) * sizeCols], sizeCols);
+
+    // Gradient (parallel within the shard)
+    std::vector<double> gradient(localRows * sizeCols, 0.0);
+    std::vector<int> theta(localRows * sizeCols, 0);
+    std::vector<int> pixelsCanny(localRows * sizeCols, 0);
+    double* G = gradient.data();
+    double largestG = 0;
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    ThreadData base = {};
+    base.sizeRows = localRows;
+    base.sizeCols = sizeCols;
+    base.sizeDepth = 1;
+    base.inputPixels = &gray;
+    base.outputPixels = &pixelsCanny;
+    base.G = G;
+    base.theta = &theta;
+    base.lowerThreshold = lowerThreshold;
+    base.higherThreshold = higherThreshold;
+    base.largestG = &largestG;
+    base.mutex = &mutex;
+
+    int numBands = std::max(1, std::min(getNumThreads(), lastRow - firstRow));
+    std::vector<ThreadData> threadData(numBands, base);
+    for (int t = 0; t < numBands; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numThreads = numBands;
+        threadData[t].startRow = firstRow + (lastRow - firstRow) * t / numBands;
+        threadData[t].endRow = firstRow + (lastRow - firstRow) * (t + 1) / numBands;
+    }
+    runThreads(cannyPhase1Worker, threadData.data(), numBands, numBands);
+    std::vector<int>().swap(gray);
+
+    // Edge pixels, in the same order as cannyFilter_parallel
+    for (int j = 1; j < sizeCols - 1; j++) {
+        if (first) {
+            G[sizeCols + j] = G[2 * sizeCols + j];
+            theta[sizeCols + j] = theta[2 * sizeCols + j];
+        }
+        if (last) {
+            G[n * sizeCols + j] = G[(n - 1) * sizeCols + j];
+            theta[n * sizeCols + j] = theta[(n - 1) * sizeCols + j];
+        }
+    }
+    for (int i = 1; i <= n; i++) {
+        G[i * sizeCols] = G[i * sizeCols + 1];
+        theta[i * sizeCols] = theta[i * sizeCols + 1];
+        G[i * sizeCols + sizeCols - 1] = G[i * sizeCols + sizeCols - 2];
+        theta[i * sizeCols + sizeCols - 1] = theta[i * sizeCols + sizeCols - 2];
+    }
+
+    // Exchange gradient boundary rows and the shard maxima
+    control->largestG[shard] = largestG;
+    copyRow(&G[sizeCols], haloRow(segment, shard, HALO_G_FIRST), sizeCols);
+    copyRow(&G[n * sizeCols], haloRow(segment, shard, HALO_G_LAST), sizeCols);
+    pthread_barrier_wait(&control->barrier);
+    if (!first) copyRow(haloRow(segment, shard - 1, HALO_G_LAST), &G[0], sizeCols);
+    if (!last) copyRow(haloRow(segment, shard + 1, HALO_G_FIRST), &G[(n + 1) * sizeCols], sizeCols);
+    for (int s = 0; s < numShards; s++) {
+        largestG = std::max(largestG, control->largestG[s]);
+    }
+
+    // NMS, speculatively reading the shard above's last row before suppression.
+    // NMS suppresses in place in raster order, so each row depends on the
+    // final row above it.
+    std::vector<double> gradientRaw(gradient);
+    ThreadData nms = base;
+    nms.startRow = firstRow;
+    nms.endRow = lastRow;
+    cannyPhase2Worker(&nms);
+
+    // NMS seam pass, in shard order: redo rows with the final row above until
+    // one comes out unchanged, the rows below it are then unchanged as well
+    int nmsRowsPatched = 0;
+    if (!first) {
+        sem_wait(&control->nmsReady[shard]);
+        copyRow(haloRow(segment, shard - 1, HALO_NMS_LAST), &G[0], sizeCols);
+
+        std::vector<double> speculative(&G[firstRow * sizeCols], &G[(firstRow + 1) * sizeCols]);
+        std::vector<double> next(sizeCols);
+        for (int r = firstRow; r < lastRow; r++) {
+            bool hasNext = r + 1 < lastRow;
+            std::copy(&gradientRaw[r * sizeCols], &gradientRaw[(r + 1) * sizeCols], &G[r * sizeCols]);
+            if (hasNext) {
+                // The row below is read before its own suppression
+                std::copy(&G[(r + 1) * sizeCols], &G[(r + 2) * sizeCols], next.begin());
+                std::copy(&gradientRaw[(r + 1) * sizeCols], &gradientRaw[(r + 2) * sizeCols], &G[(r + 1) * sizeCols]);
+            }
+            nms.startRow = r;
+            nms.endRow = r + 1;
+            cannyPhase2Worker(&nms);
+            nmsRowsPatched++;
+
+            if (std::equal(&G[r * sizeCols], &G[(r + 1) * sizeCols], speculative.begin())) {
+                if (hasNext) std::copy(next.begin(), next.end(), &G[(r + 1) * sizeCols]);
+                break;
+            }
+            speculative.swap(next);
+        }
+    }
+    std::vector<double>().swap(gradientRaw);
+
+    copyRow(&G[sizeCols], haloRow(segment, shard, HALO_NMS_FIRST), sizeCols);
+    copyRow(&G[n * sizeCols], haloRow(segment, shard, HALO_NMS_LAST), sizeCols);
+    if (!last) sem_post(&control->nmsReady[shard + 1]);
+    pthread_barrier_wait(&control->barrier);
+    if (!last) copyRow(haloRow(segment, shard + 1, HALO_NMS_FIRST), &G[(n + 1) * sizeCols], sizeCols);
+
+    // Hysteresis. A weak pixel is kept if it touches a strong pixel or an
+    // earlier (raster order) kept pixel. The shard above's weak pixels are
+    // assumed dropped here and the ones it keeps are added by the seam pass.
+    double low = lowerThreshold * largestG;
+    double high = higherThreshold * largestG;
+    std::vector<uint8_t> weak(localRows * sizeCols, 0);
+    for (int i = firstRow; i < lastRow; i++) {
+        for (int j = 1; j < sizeCols - 1; j++) {
+            weak[i * sizeCols + j] = G[i * sizeCols + j] >= low && G[i * sizeCols + j] < high;
+        }
+    }
+    if (!first) {
+        for (int j = 1; j < sizeCols - 1; j++) {
+            if (G[j] < high) G[j] = 0;
+        }
+    }
+    int hystStart = first ? 1 : 0;
+    int hystEnd = last ? n + 1 : n + 2;
+    cannyHysteresis(&G[hystStart * sizeCols], &pixelsCanny[hystStart * sizeCols], hystEnd - hystStart,
+                    sizeCols, lowerThreshold, higherThreshold, largestG);
+
+    // Hysteresis seam pass, in shard order: promote the weak pixels under
+    // kept pixels of the row above and everything they reach forward
+    int promoted = 0;
+    if (!first) {
+        sem_wait(&control->hysteresisReady[shard]);
+        const double* above = haloRow(segment, shard - 1, HALO_HYSTERESIS_LAST);
+
+        std::vector<int> stack;
+        auto promote = [&](int p) {
+            G[p] = higherThreshold * largestG;
+            pixelsCanny[p] = (int)(G[p] * (255.0 / largestG));
+            stack.push_back(p);
+            promoted++;
+        };
+        for (int j = 1; j < sizeCols - 1; j++) {
+            int p = firstRow * sizeCols + j;
+            if (!weak[p] || G[p] != 0) continue;
+            if (above[j - 1] >= high || above[j] >= high || above[j + 1] >= high) promote(p);
+        }
+        const int forward[4][2] = {{0, 1}, {1, -1}, {1, 0}, {1, 1}};
+        while (!stack.empty()) {
+            int p = stack.back();
+            stack.pop_back();
+            for (const auto& d : forward) {
+                int i = p / sizeCols + d[0];
+                int j = p % sizeCols + d[1];
+                if (i >= lastRow || j < 1 || j >= sizeCols - 1) continue;
+                int q = i * sizeCols + j;
+                if (weak[q] && G[q] == 0) promote(q);
+            }
+        }
+    }
+    copyRow(&G[n * sizeCols], haloRow(segment, shard, HALO_HYSTERESIS_LAST), sizeCols);
+    if (!last) sem_post(&control->hysteresisReady[shard + 1]);
+
+    // Write the shard's rows of the edge map in place
+    uint8_t* edges = segment.edges.ptr(startRow);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < sizeCols; j++) {
+            edges[i * sizeCols + j] = (uint8_t)pixelsCanny[(i + 1) * sizeCols + j];
+        }
+    }
+
+    control->nmsRowsPatched[shard] = nmsRowsPatched;
+    control->hysteresisPatched[shard] = promoted;
+    pthread_mutex_destroy(&mutex);
+    return 0;
+}
+
+// ============================================================================
+// COORDINATOR
+// ============================================================================
+
+bool createShardSegment(int sizeRows, int sizeCols, int sizeDepth, int numShards,
+                        ShardSegment& segment, std::string& error) {
+    if (numShards < 1 || numShards > MAX_SHARDS) {
+        error = "shard count must be between 1 and " + std::to_string(MAX_SHARDS);
+        return false;
+    }
+    if (sizeRows / numShards < 2 || sizeCols < 3) {
+        error = "image too small for " + std::to_string(numShards) + " shards (at least two rows each)";
+        return false;
+    }
+
+    static std::atomic<int> counter(0);
+    segment.name = "/canny_shard_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+    SegmentLayout layout = segmentLayout(sizeRows, sizeCols, sizeDepth, numShards);
+
+    int fd = shm_open(segment.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, layout.size) != 0) {
+        error = std::string("shm_open failed: ") + strerror(errno);
+        if (fd >= 0) close(fd);
+        shm_unlink(segment.name.c_str());
+        return false;
+    }
+    void* data = mmap(nullptr, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        error = std::string("mmap failed: ") + strerror(errno);
+        shm_unlink(segment.name.c_str());
+        return false;
+    }
+
+    segment.data = (uint8_t*)data;
+    segment.size = layout.size;
+    segment.numShards = numShards;
+    segment.input = cv::Mat(sizeRows, sizeCols, CV_8UC(sizeDepth), segment.data + layout.input);
+    segment.edges = cv::Mat(sizeRows, sizeCols, CV_8UC1, segment.data + layout.edges);
+
+    ShardControl* control = (ShardControl*)segment.data;
+    control->sizeRows = sizeRows;
+    control->sizeCols = sizeCols;
+    control->sizeDepth = sizeDepth;
+    control->numShards = numShards;
+    return true;
+}
+
+void destroyShardSegment(ShardSegment& segment) {
+    segment.input = cv::Mat();
+    segment.edges = cv::Mat();
+    if (segment.data) munmap(segment.data, segment.size);
+    if (!segment.name.empty()) shm_unlink(segment.name.c_str());
+    segment.data = nullptr;
+    segment.size = 0;
+    segment.name.clear();
+}
+
+// Contiguous slice of the allowed CPUs for one worker
+static void pinToSlice(int shard, int numShards) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+    }
+    if (cpus.empty()) return;
+
+    cpu_set_t slice;
+    CPU_ZERO(&slice);
+    int numCpus = (int)cpus.size();
+    if (numCpus >= numShards) {
+        for (int c = numCpus * shard / numShards; c < numCpus * (shard + 1) / numShards; c++) {
+            CPU_SET(cpus[c], &slice);
+        }
+    } else {
+        CPU_SET(cpus[shard % numCpus], &slice);
+    }
+    sched_setaffinity(0, sizeof(slice), &slice);
+}
+
+bool runShards(ShardSegment& segment, int threadsPerShard, double lowerThreshold, double higherThreshold,
+               bool pinWorkers, std::string& error, ShardStats* stats) {
+    if (!segment.data) {
+        error = "segment is not mapped";
+        return false;
+    }
+    if (isWorkerPoolRunning()) {
+        error = "the worker pool must be stopped before forking shard workers";
+        return false;
+    }
+
+    ShardControl* control = (ShardControl*)segment.data;
+    int numShards = control->numShards;
+    control->lowerThreshold = lowerThreshold;
+    control->higherThreshold = higherThreshold;
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&control->barrier, &attr, numShards);
+    pthread_barrierattr_destroy(&attr);
+    for (int s = 0; s < numShards; s++) {
+        sem_init(&control->nmsReady[s], 1, 0);
+        sem_init(&control->hysteresisReady[s], 1, 0);
+        control->nmsRowsPatched[s] = 0;
+        control->hysteresisPatched[s] = 0;
+    }
+
+    double start = getCurrentTimeMs();
+    std::vector<pid_t> workers;
+    bool failed = false;
+    for (int s = 0; s < numShards; s++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            error = std::string("fork failed: ") + strerror(errno);
+            failed = true;
+            break;
+        }
+        if (pid == 0) {
+            if (pinWorkers) pinToSlice(s, numShards);
+            setNumThreads(threadsPerShard);
+            _exit(shardWorker(segment, s));
+        }
+        workers.push_back(pid);
+    }
+
+    // A worker that dies leaves the others blocked on the barrier or a seam,
+    // so the first failure stops the whole run
+    if (failed) {
+        for (pid_t pid : workers) kill(pid, SIGKILL);
+    }
+    std::vector<bool> done(workers.size(), false);
+    size_t remaining = workers.size();
+    while (remaining > 0) {
+        bool reaped = false;
+        for (size_t w = 0; w < workers.size(); w++) {
+            if (done[w]) continue;
+            int status;
+            pid_t pid = waitpid(workers[w], &status, WNOHANG);
+            if (pid == 0) continue;
+            done[w] = true;
+            remaining--;
+            reaped = true;
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                if (!failed) {
+                    error = "shard worker " + std::to_string(w) + " failed";
+                    failed = true;
+                }
+                for (size_t o = 0; o < workers.size(); o++) {
+                    if (!done[o]) kill(workers[o], SIGKILL);
+                }
+            }
+        }
+        if (!reaped) usleep(100);
+    }
+
+    pthread_barrier_destroy(&control->barrier);
+    for (int s = 0; s < numShards; s++) {
+        sem_destroy(&control->nmsReady[s]);
+        sem_destroy(&control->hysteresisReady[s]);
+    }
+
+    if (stats) {
+        stats->totalTime = getCurrentTimeMs() - start;
+        stats->nmsRowsPatched = 0;
+        stats->hysteresisPatched = 0;
+        for (int s = 0; s < numShards; s++) {
+            stats->nmsRowsPatched += control->nmsRowsPatched[s];
+            stats->hysteresisPatched += control->hysteresisPatched[s];
+        }
+    }
+    return !failed;
+}
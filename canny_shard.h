@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include <opencv2/highgui.hpp>
+
+// Multi-process sharded execution on one machine.
+//
+// The coordinator creates one POSIX shared memory segment holding the BGR
+// input, the edge map and a few halo rows per shard, then forks one worker
+// process per horizontal shard. Each worker keeps its intermediate buffers
+// in its own address space (and heap), reads its rows plus a two-row border
+// straight from the shared input, and writes its rows of the edge map in
+// place, so the result is assembled without a gather copy.
+//
+// Between stages the workers exchange only boundary rows through the
+// segment: gray rows for the Sobel stencil, gradient rows and the per-shard
+// maximum for non-maximum suppression. NMS and hysteresis are sequential in
+// raster order, so each shard first runs them speculatively and then, in
+// shard order, patches the rows that depend on the final last row of the
+// shard above. The patches are small and the edge map is identical to the
+// exact single-threaded pipeline (channel-first, PRECISION_EXACT) for
+// lowerThreshold > 0.
+//
+// Workers can be given a share of the coordinator's CPUs each, so shards on
+// different NUMA nodes keep their private buffers local.
+
+// Most shards per run
+const int MAX_SHARDS = 64;
+
+struct ShardSegment {
+    std::string name;        // shm_open name
+    uint8_t* data = nullptr; // whole mapping
+    size_t size = 0;
+    int numShards = 0;
+    cv::Mat input;           // rows x cols view (BGR, or gray when depth is 1), filled by the caller
+    cv::Mat edges;           // rows x cols CV_8UC1 view, filled by runShards
+};
+
+struct ShardStats {
+    double totalTime;      // fork to last worker exit (ms)
+    int nmsRowsPatched;    // rows recomputed by the NMS seam passes
+    int hysteresisPatched; // pixels promoted by the hysteresis seam passes
+};
+
+// Create and map the segment for a rows x cols x depth image split into
+// numShards shards (at least two rows each). Returns false with error set
+// on failure.
+bool createShardSegment(int sizeRows, int sizeCols, int sizeDepth, int numShards,
+                        ShardSegment& segment, std::string& error);
+
+// Unmap and unlink the segment; input and edges become invalid
+void destroyShardSegment(ShardSegment& segment);
+
+// Run the pipeline on segment.input with one worker process per shard, each
+// using threadsPerShard threads. pinWorkers gives every worker a contiguous
+// slice of the calling process's CPU affinity mask. Must not be called while
+// the worker pool is running (its threads do not survive fork).
+bool runShards(ShardSegment& segment, int threadsPerShard, double lowerThreshold, double higherThreshold,
+               bool pinWorkers, std::string& error, ShardStats* stats = nullptr);
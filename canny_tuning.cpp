@@ -0,0 +1,311 @@
+#include "canny_tuning.h"
+#include "canny.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <unistd.h>
+
+// Timed runs per candidate after one warm-up run; the median is kept
+const int TUNE_RUNS = 5;
+// Row-chunk sizes tried after the thread count (0 = one band per thread)
+const int TUNE_CHUNK_ROWS[] = {8, 32, 128};
+
+// rows, cols, depth, precision, pipeline, sparsity, backend, thread budget
+typedef std::tuple<int, int, int, int, int, int, int, int> TuningKey;
+
+static bool initialAutoTune() {
+    const char* env = getenv("CANNY_AUTOTUNE");
+    return env && std::string(env) == "1";
+}
+
+static bool g_autoTune = initialAutoTune();
+static std::map<TuningKey, TuningConfig> g_cache;
+static bool g_cacheLoaded = false;
+static pthread_mutex_t g_cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+// Keys being tuned by some thread; waiters sleep on g_tuningDone
+static std::set<TuningKey> g_tuningInFlight;
+static pthread_cond_t g_tuningDone = PTHREAD_COND_INITIALIZER;
+
+void setAutoTune(bool enabled) {
+    g_autoTune = enabled;
+}
+
+bool getAutoTune() {
+    return g_autoTune;
+}
+
+std::string tuningCachePath() {
+    const char* path = getenv("CANNY_TUNING_CACHE");
+    if (path && *path) return path;
+    const char* home = getenv("HOME");
+    if (home && *home) return std::string(home) + "/.canny_tuning";
+    return ".canny_tuning";
+}
+
+static TuningKey makeKey(int sizeRows, int sizeCols, int sizeDepth) {
+    return TuningKey(sizeRows, sizeCols, sizeDepth, getPrecisionMode(), getPipelineMode(), getSparsityMode(),
+                     getParallelBackend(), getNumThreads());
+}
+
+// ============================================================================
+// CACHE FILE
+// ============================================================================
+
+// One entry per line:
+//   rows cols depth precision pipeline sparsity backend threads  blurThreads
+//   blurChunk blurKernel  grayThreads grayChunk  cannyThreads cannyChunk
+// Lines of other lengths (older formats) are skipped and retuned.
+
+static bool loadCacheLocked(const std::string& path) {
+    g_cacheLoaded = true;
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        std::vector<int> fields;
+        int field;
+        while (in >> field) fields.push_back(field);
+        if (!in.eof() || fields.size() != 15) continue;
+        const int* f = fields.data();
+        TuningConfig config = {};
+        config.stages[STAGE_BLUR].numThreads = f[8];
+        config.stages[STAGE_BLUR].chunkRows = f[9];
+        config.blurKernel = f[10] == BLUR_KERNEL_INTERIOR ? BLUR_KERNEL_INTERIOR : BLUR_KERNEL_GENERIC;
+        config.stages[STAGE_GRAY].numThreads = f[11];
+        config.stages[STAGE_GRAY].chunkRows = f[12];
+        config.stages[STAGE_CANNY].numThreads = f[13];
+        config.stages[STAGE_CANNY].chunkRows = f[14];
+        g_cache[TuningKey(f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7])] = config;
+    }
+    return true;
+}
+
+static bool saveCacheLocked(const std::string& path) {
+    // Write a temporary file and rename it so readers never see a partial cache
+    std::string tmpPath = path + ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmpPath);
+    if (!file) return false;
+
+    file << "# canny tuning cache\n"
+         << "# rows cols depth precision pipeline sparsity backend threads  blurThreads blurChunk blurKernel  "
+         << "grayThreads grayChunk  cannyThreads cannyChunk\n";
+    for (const auto& entry : g_cache) {
+        const TuningKey& key = entry.first;
+        const TuningConfig& config = entry.second;
+        file << std::get<0>(key) << " " << std::get<1>(key) << " " << std::get<2>(key) << " "
+             << std::get<3>(key) << " " << std::get<4>(key) << " " << std::get<5>(key) << " "
+             << std::get<6>(key) << " " << std::get<7>(key) << "  "
+             << config.stages[STAGE_BLUR].numThreads << " " << config.stages[STAGE_BLUR].chunkRows << " "
+             << config.blurKernel << "  "
+             << config.stages[STAGE_GRAY].numThreads << " " << config.stages[STAGE_GRAY].chunkRows << "  "
+             << config.stages[STAGE_CANNY].numThreads << " " << config.stages[STAGE_CANNY].chunkRows << "\n";
+    }
+    file.close();
+    if (!file || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadTuningCache(const std::string& path) {
+    pthread_mutex_lock(&g_cacheMutex);
+    bool ok = loadCacheLocked(path);
+    pthread_mutex_unlock(&g_cacheMutex);
+    return ok;
+}
+
+bool saveTuningCache(const std::string& path) {
+    pthread_mutex_lock(&g_cacheMutex);
+    bool ok = saveCacheLocked(path);
+    pthread_mutex_unlock(&g_cacheMutex);
+    return ok;
+}
+
+bool lookupTuning(int sizeRows, int sizeCols, int sizeDepth, TuningConfig& config) {
+    TuningKey key = makeKey(sizeRows, sizeCols, sizeDepth);
+    pthread_mutex_lock(&g_cacheMutex);
+    if (!g_cacheLoaded) loadCacheLocked(tuningCachePath());
+    auto it = g_cache.find(key);
+    bool found = it != g_cache.end();
+    if (found) config = it->second;
+    pthread_mutex_unlock(&g_cacheMutex);
+    return found;
+}
+
+// ============================================================================
+// SEARCH
+// ============================================================================
+
+// Run one stage of the pipeline on the buffers in ws
+static void runStage(CannyStage stage, const cv::Mat& img, CannyWorkspace& ws,
+                     double lowerThreshold, double higherThreshold) {
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    makeGaussianKernel(kernel, kernelConst);
+    int sizeRows = img.rows;
+    int sizeCols = img.cols;
+    bool luma = getPipelineMode() != PIPELINE_CHANNEL_FIRST;
+    int sizeDepth = luma ? 1 : img.channels();
+
+    switch (stage) {
+    case STAGE_BLUR:
+        // In luma mode ws.pixels holds the weighted sums
+        gaussianBlur_parallel(ws.pixels, kernel, kernelConst, sizeRows, sizeCols, sizeDepth, ws.pixelsBlur);
+        break;
+    case STAGE_GRAY:
+        if (luma) {
+            lumaBlur_parallel(img, getPipelineMode(), kernel, kernelConst, ws.pixels, ws.pixelsBlur, ws.pixelsGray);
+        } else {
+            rgbToGrayscale_parallel(ws.pixelsBlur, sizeRows, sizeCols, sizeDepth, ws.pixelsGray);
+        }
+        break;
+    case STAGE_CANNY:
+        if (getPrecisionMode() != PRECISION_EXACT) {
+            cannyFilterFast_parallel(ws.pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold,
+                                     getPrecisionMode(), ws.Gfast, ws.theta, ws.pixelsCanny);
+        } else {
+            cannyFilter_parallel(ws.pixelsGray, sizeRows, sizeCols, 1, lowerThreshold, higherThreshold,
+                                 ws.G, ws.theta, ws.pixelsCanny);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static double timeStage(CannyStage stage, const TuningConfig& config, const cv::Mat& img, CannyWorkspace& ws,
+                        double lowerThreshold, double higherThreshold) {
+    setTuningConfig(config);
+    runStage(stage, img, ws, lowerThreshold, higherThreshold);
+    double times[TUNE_RUNS];
+    for (int r = 0; r < TUNE_RUNS; r++) {
+        double start = getCurrentTimeMs();
+        runStage(stage, img, ws, lowerThreshold, higherThreshold);
+        times[r] = getCurrentTimeMs() - start;
+    }
+    std::nth_element(times, times + TUNE_RUNS / 2, times + TUNE_RUNS);
+    return times[TUNE_RUNS / 2];
+}
+
+TuningConfig autoTune(const cv::Mat& img, CannyWorkspace& ws, double lowerThreshold, double higherThreshold) {
+    int budget = getNumThreads();
+    std::vector<int> threadCounts;
+    for (int n = 1; n < budget; n *= 2) threadCounts.push_back(n);
+    threadCounts.push_back(budget);
+
+    // Fill the intermediate buffers once with the default settings. The stages
+    // are run directly so the buffers stay in ws whatever the memory mode.
+    TuningConfig config = {};
+    setTuningConfig(config);
+    if (getPipelineMode() == PIPELINE_CHANNEL_FIRST) {
+        ws.pixels = imgToArray(img, (uint8_t*)img.data, img.rows, img.cols, img.channels());
+        runStage(STAGE_BLUR, img, ws, lowerThreshold, higherThreshold);
+    }
+    runStage(STAGE_GRAY, img, ws, lowerThreshold, higherThreshold);
+    runStage(STAGE_CANNY, img, ws, lowerThreshold, higherThreshold);
+    for (int s = 0; s < NUM_STAGES; s++) {
+        config.stages[s].numThreads = budget;
+    }
+
+    // Greedy per stage: kernel variant, then thread count, then chunk size.
+    // Stages are independent, so each is tuned with the others fixed.
+    CannyStage stages[] = {STAGE_BLUR, STAGE_GRAY, STAGE_CANNY};
+    for (CannyStage stage : stages) {
+        double best = timeStage(stage, config, img, ws, lowerThreshold, higherThreshold);
+
+        if (stage == STAGE_BLUR) {
+            TuningConfig candidate = config;
+            candidate.blurKernel = BLUR_KERNEL_INTERIOR;
+            double t = timeStage(stage, candidate, img, ws, lowerThreshold, higherThreshold);
+            if (t < best) {
+                best = t;
+                config = candidate;
+            }
+        }
+
+        for (int n : threadCounts) {
+            if (n == config.stages[stage].numThreads) continue;
+            TuningConfig candidate = config;
+            candidate.stages[stage].numThreads = n;
+            double t = timeStage(stage, candidate, img, ws, lowerThreshold, higherThreshold);
+            if (t < best) {
+                best = t;
+                config = candidate;
+            }
+        }
+
+        if (config.stages[stage].numThreads > 1) {
+            for (int chunkRows : TUNE_CHUNK_ROWS) {
+                if (chunkRows * config.stages[stage].numThreads > img.rows) continue;
+                TuningConfig candidate = config;
+                candidate.stages[stage].chunkRows = chunkRows;
+                double t = timeStage(stage, candidate, img, ws, lowerThreshold, higherThreshold);
+                if (t < best) {
+                    best = t;
+                    config = candidate;
+                }
+            }
+        }
+    }
+
+    setTuningConfig(config);
+
+    TuningKey key = makeKey(img.rows, img.cols, img.channels());
+    pthread_mutex_lock(&g_cacheMutex);
+    if (!g_cacheLoaded) loadCacheLocked(tuningCachePath());
+    g_cache[key] = config;
+    saveCacheLocked(tuningCachePath());
+    pthread_mutex_unlock(&g_cacheMutex);
+
+    return config;
+}
+
+void applyAutoTuning(const cv::Mat& img, CannyWorkspace& ws, double lowerThreshold, double higherThreshold) {
+    TuningKey key = makeKey(img.rows, img.cols, img.channels());
+    pthread_mutex_lock(&g_cacheMutex);
+    if (!g_cacheLoaded) loadCacheLocked(tuningCachePath());
+    // Only the first caller times a key. The others wait for its result
+    // rather than loading the cores while it measures.
+    while (g_tuningInFlight.count(key)) {
+        pthread_cond_wait(&g_tuningDone, &g_cacheMutex);
+    }
+    auto it = g_cache.find(key);
+    if (it != g_cache.end()) {
+        TuningConfig config = it->second;
+        pthread_mutex_unlock(&g_cacheMutex);
+        setTuningConfig(config);
+        return;
+    }
+    g_tuningInFlight.insert(key);
+    pthread_mutex_unlock(&g_cacheMutex);
+
+    autoTune(img, ws, lowerThreshold, higherThreshold);
+
+    pthread_mutex_lock(&g_cacheMutex);
+    g_tuningInFlight.erase(key);
+    pthread_cond_broadcast(&g_tuningDone);
+    pthread_mutex_unlock(&g_cacheMutex);
+}
+
+std::string formatTuningConfig(const TuningConfig& config) {
+    const char* names[NUM_STAGES] = {"blur", "gray", "canny"};
+    std::string out;
+    for (int s = 0; s < NUM_STAGES; s++) {
+        if (s > 0) out += ", ";
+        out += std::string(names[s]) + " " + std::to_string(config.stages[s].numThreads) + "/" +
+               std::to_string(config.stages[s].chunkRows);
+        if (s == STAGE_BLUR) {
+            out += config.blurKernel == BLUR_KERNEL_INTERIOR ? " interior" : " generic";
+        }
+    }
+    return out;
+}
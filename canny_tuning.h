@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/highgui.hpp>
+
+#include "canny_parallel.h"
+
+// Auto-tuning of the per-stage settings (TuningConfig) for each image size.
+//
+// The first time an image geometry is seen with auto-tuning enabled, every
+// stage is timed with a few thread counts and row-chunk sizes and the blur
+// with both kernel variants (BlurKernel); the fastest settings are kept.
+// Results are persisted in a plain-text cache file so later runs of canny
+// (and any other program linking the library) start with the tuned settings.
+//
+// The cache file is $CANNY_TUNING_CACHE, else $HOME/.canny_tuning, else
+// ./.canny_tuning. Entries are keyed by rows, cols, depth, precision mode,
+// pipeline mode, sparsity mode, parallel backend and thread budget. Setting
+// CANNY_AUTOTUNE=1 enables auto-tuning at startup.
+
+// When enabled, cannyEdgeDetection_parallel applies (or first measures) the
+// tuned settings for each image it processes
+void setAutoTune(bool enabled);
+bool getAutoTune();
+
+std::string tuningCachePath();
+
+// Read the cache file into memory. It is also loaded lazily on first lookup.
+bool loadTuningCache(const std::string& path = tuningCachePath());
+bool saveTuningCache(const std::string& path = tuningCachePath());
+
+// Cached settings for the image geometry under the current modes and
+// getNumThreads(), if any
+bool lookupTuning(int sizeRows, int sizeCols, int sizeDepth, TuningConfig& config);
+
+// Time the candidates on img (ws is used as scratch) and store the result in
+// the cache and the cache file
+TuningConfig autoTune(const cv::Mat& img, CannyWorkspace& ws, double lowerThreshold, double higherThreshold);
+
+// Look up the settings for img, tuning on a miss, and make them the calling
+// thread's TuningConfig. Concurrent callers with the same key wait for the
+// one tuning it.
+void applyAutoTuning(const cv::Mat& img, CannyWorkspace& ws, double lowerThreshold, double higherThreshold);
+
+// "threads/chunk" per stage and the blur kernel, e.g.
+// "blur 8/32 interior, gray 4/0, canny 8/16"
+std::string formatTuningConfig(const TuningConfig& config);
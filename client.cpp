@@ -0,0 +1,306 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "canny_daemon.h"
+#include "canny_parallel.h"
+
+// Client for canny_daemon, also usable as a load generator.
+//
+//   ./canny_client path  <input> <output>
+//   ./canny_client shm   <input> <output>
+//   ./canny_client stats
+//   ./canny_client load  <input> <requests> <concurrency> [path|shm]
+//
+// The socket is taken from $CANNY_SOCKET, defaulting to CANNY_DAEMON_SOCKET.
+
+static double g_lowerThreshold = 0.03;
+static double g_higherThreshold = 0.1;
+
+static bool readFull(int fd, void* buf, size_t len) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeFull(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static int connectDaemon() {
+    std::string socketPath = getenv("CANNY_SOCKET") ? getenv("CANNY_SOCKET") : CANNY_DAEMON_SOCKET;
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "Error: could not connect to " << socketPath << ": " << strerror(errno) << "\n";
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static DaemonRequest makeRequest(DaemonOp op) {
+    DaemonRequest request;
+    memset(&request, 0, sizeof(request));
+    request.magic = CANNY_DAEMON_MAGIC;
+    request.op = op;
+    request.lowerThreshold = g_lowerThreshold;
+    request.higherThreshold = g_higherThreshold;
+    return request;
+}
+
+static bool sendRequest(int fd, const DaemonRequest& request, DaemonResponse& response) {
+    if (!writeFull(fd, &request, sizeof(request)) || !readFull(fd, &response, sizeof(response))) {
+        std::cerr << "Error: connection to daemon lost\n";
+        return false;
+    }
+    if (response.status != 0) {
+        std::cerr << "Error: " << response.message << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Shared memory segment holding one image and the daemon's edge map
+struct ShmImage {
+    std::string name;
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    int rows = 0;
+    int cols = 0;
+    int depth = 0;
+};
+
+static bool createShmImage(ShmImage& shm, const cv::Mat& img, const std::string& name) {
+    shm.name = name;
+    shm.rows = img.rows;
+    shm.cols = img.cols;
+    shm.depth = img.channels();
+    shm.size = daemonShmSize(shm.rows, shm.cols, shm.depth);
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, shm.size) != 0) {
+        std::cerr << "Error: could not create shared memory " << name << ": " << strerror(errno) << "\n";
+        if (fd >= 0) close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    shm.data = (uint8_t*)mmap(nullptr, shm.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm.data == MAP_FAILED) {
+        shm.data = nullptr;
+        shm_unlink(name.c_str());
+        return false;
+    }
+    size_t rowBytes = (size_t)shm.cols * shm.depth;
+    for (int i = 0; i < shm.rows; i++) {
+        memcpy(shm.data + i * rowBytes, img.ptr(i), rowBytes);
+    }
+    return true;
+}
+
+static void destroyShmImage(ShmImage& shm) {
+    if (shm.data) munmap(shm.data, shm.size);
+    shm_unlink(shm.name.c_str());
+    shm.data = nullptr;
+}
+
+static DaemonRequest makeShmRequest(const ShmImage& shm) {
+    DaemonRequest request = makeRequest(OP_SHM);
+    request.rows = shm.rows;
+    request.cols = shm.cols;
+    request.depth = shm.depth;
+    snprintf(request.input, sizeof(request.input), "%s", shm.name.c_str());
+    return request;
+}
+
+static int runPath(const std::string& input, const std::string& output) {
+    int fd = connectDaemon();
+    if (fd < 0) return 1;
+    DaemonRequest request = makeRequest(OP_PATH);
+    snprintf(request.input, sizeof(request.input), "%s", input.c_str());
+    snprintf(request.output, sizeof(request.output), "%s", output.c_str());
+    DaemonResponse response;
+    bool ok = sendRequest(fd, request, response);
+    close(fd);
+    if (ok) std::cout << "Done in " << response.latencyMs << " ms (daemon side)\n";
+    return ok ? 0 : 1;
+}
+
+static int runShm(const std::string& input, const std::string& output) {
+    cv::Mat img = cv::imread(input);
+    if (img.empty()) {
+        std::cerr << "Error: Could not read image from " << input << "\n";
+        return 1;
+    }
+    ShmImage shm;
+    if (!createShmImage(shm, img, "/canny_client_" + std::to_string(getpid()))) return 1;
+
+    int fd = connectDaemon();
+    DaemonResponse response;
+    bool ok = fd >= 0 && sendRequest(fd, makeShmRequest(shm), response);
+    if (fd >= 0) close(fd);
+
+    if (ok) {
+        cv::Mat edges(shm.rows, shm.cols, CV_8UC1, shm.data + (size_t)shm.rows * shm.cols * shm.depth);
+        cv::imwrite(output, edges);
+        std::cout << "Done in " << response.latencyMs << " ms (daemon side)\n";
+    }
+    destroyShmImage(shm);
+    return ok ? 0 : 1;
+}
+
+static int runStats() {
+    int fd = connectDaemon();
+    if (fd < 0) return 1;
+    DaemonResponse response;
+    bool ok = sendRequest(fd, makeRequest(OP_STATS), response);
+    close(fd);
+    if (ok) std::cout << response.message << "\n";
+    return ok ? 0 : 1;
+}
+
+// Load generation: each thread owns one connection and sends its share of
+// the requests back to back, recording round-trip latencies.
+struct LoadThreadData {
+    int threadId;
+    int numRequests;
+    bool useShm;
+    std::string input;
+    const cv::Mat* img;
+    std::vector<double> latencies;
+    int failures;
+};
+
+void* loadWorker(void* arg) {
+    LoadThreadData* data = (LoadThreadData*)arg;
+    data->failures = 0;
+
+    ShmImage shm;
+    DaemonRequest request;
+    if (data->useShm) {
+        std::string name = "/canny_client_" + std::to_string(getpid()) + "_" + std::to_string(data->threadId);
+        if (!createShmImage(shm, *data->img, name)) {
+            data->failures = data->numRequests;
+            return nullptr;
+        }
+        request = makeShmRequest(shm);
+    } else {
+        request = makeRequest(OP_PATH);
+        snprintf(request.input, sizeof(request.input), "%s", data->input.c_str());
+        snprintf(request.output, sizeof(request.output), "/tmp/canny_client_%d_%d.jpg", getpid(), data->threadId);
+    }
+
+    int fd = connectDaemon();
+    for (int r = 0; r < data->numRequests && fd >= 0; r++) {
+        DaemonResponse response;
+        double start = getCurrentTimeMs();
+        if (sendRequest(fd, request, response)) {
+            data->latencies.push_back(getCurrentTimeMs() - start);
+        } else {
+            data->failures++;
+        }
+    }
+    if (fd < 0) data->failures = data->numRequests;
+    else close(fd);
+
+    if (data->useShm) destroyShmImage(shm);
+    else unlink(request.output);
+    return nullptr;
+}
+
+static int runLoad(const std::string& input, int numRequests, int concurrency, bool useShm) {
+    cv::Mat img = cv::imread(input);
+    if (img.empty()) {
+        std::cerr << "Error: Could not read image from " << input << "\n";
+        return 1;
+    }
+
+    pthread_t threads[concurrency];
+    std::vector<LoadThreadData> threadData(concurrency);
+
+    double start = getCurrentTimeMs();
+    for (int t = 0; t < concurrency; t++) {
+        threadData[t].threadId = t;
+        threadData[t].numRequests = numRequests / concurrency + (t < numRequests % concurrency ? 1 : 0);
+        threadData[t].useShm = useShm;
+        threadData[t].input = input;
+        threadData[t].img = &img;
+        pthread_create(&threads[t], nullptr, loadWorker, &threadData[t]);
+    }
+
+    std::vector<double> latencies;
+    int failures = 0;
+    for (int t = 0; t < concurrency; t++) {
+        pthread_join(threads[t], nullptr);
+        latencies.insert(latencies.end(), threadData[t].latencies.begin(), threadData[t].latencies.end());
+        failures += threadData[t].failures;
+    }
+    double elapsed = getCurrentTimeMs() - start;
+
+    std::cout << "Requests:    " << numRequests << " (" << failures << " failed), "
+              << concurrency << " connection(s), " << (useShm ? "shm" : "path") << " mode\n";
+    std::cout << "Elapsed:     " << std::fixed << std::setprecision(2) << elapsed << " ms\n";
+    std::cout << "Throughput:  " << std::fixed << std::setprecision(2)
+              << latencies.size() * 1000.0 / elapsed << " req/s\n";
+    std::cout << "Round trip:  " << formatLatencies(latencies) << "\n";
+
+    return failures == 0 ? 0 : 1;
+}
+
+static void usage() {
+    std::cerr << "Usage:\n"
+              << "  canny_client path  <input> <output>\n"
+              << "  canny_client shm   <input> <output>\n"
+              << "  canny_client stats\n"
+              << "  canny_client load  <input> <requests> <concurrency> [path|shm]\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    std::string mode = argv[1];
+
+    if (mode == "path" && argc > 3) return runPath(argv[2], argv[3]);
+    if (mode == "shm" && argc > 3) return runShm(argv[2], argv[3]);
+    if (mode == "stats") return runStats();
+    if (mode == "load" && argc > 4) {
+        int numRequests = std::max(1, std::atoi(argv[3]));
+        int concurrency = std::max(1, std::min(std::atoi(argv[4]), numRequests));
+        bool useShm = argc > 5 && std::string(argv[5]) == "shm";
+        return runLoad(argv[2], numRequests, concurrency, useShm);
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,342 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "canny.h"
+#include "canny_daemon.h"
+#include "canny_parallel.h"
+
+// Number of most recent request latencies kept for the percentiles
+const size_t LATENCY_WINDOW = 4096;
+
+static volatile sig_atomic_t g_stop = 0;
+static int g_listenFd = -1;
+
+// Accepted connections waiting for a handler thread
+static std::deque<int> g_connections;
+static pthread_mutex_t g_connMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_connReady = PTHREAD_COND_INITIALIZER;
+
+// Latency metrics
+static pthread_mutex_t g_statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<double> g_latencies;
+static size_t g_latencyNext = 0;
+static uint64_t g_requestCount = 0;
+static uint64_t g_errorCount = 0;
+
+static void handleSignal(int) {
+    g_stop = 1;
+    if (g_listenFd >= 0) shutdown(g_listenFd, SHUT_RDWR);
+}
+
+static bool readFull(int fd, void* buf, size_t len) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        // Idle connections time out periodically so shutdown is not blocked
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !g_stop) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeFull(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void recordLatency(double latencyMs, bool ok) {
+    pthread_mutex_lock(&g_statsMutex);
+    if (g_latencies.size() < LATENCY_WINDOW) {
+        g_latencies.push_back(latencyMs);
+    } else {
+        g_latencies[g_latencyNext] = latencyMs;
+    }
+    g_latencyNext = (g_latencyNext + 1) % LATENCY_WINDOW;
+    g_requestCount++;
+    if (!ok) g_errorCount++;
+    pthread_mutex_unlock(&g_statsMutex);
+}
+
+static std::string statsMessage() {
+    pthread_mutex_lock(&g_statsMutex);
+    std::vector<double> latencies = g_latencies;
+    uint64_t requests = g_requestCount;
+    uint64_t errors = g_errorCount;
+    pthread_mutex_unlock(&g_statsMutex);
+
+    return "requests=" + std::to_string(requests) + " errors=" + std::to_string(errors) +
+           " last " + formatLatencies(latencies);
+}
+
+static void setError(DaemonResponse& response, const std::string& message) {
+    response.status = 1;
+    snprintf(response.message, sizeof(response.message), "%s", message.c_str());
+}
+
+static void processPath(const DaemonRequest& request, CannyWorkspace& ws, DaemonResponse& response) {
+    std::string readLocation = request.input;
+    std::string writeLocation = request.output;
+    if (readLocation == writeLocation) {
+        setError(response, "The read file and save file locations cannot be the same.");
+        return;
+    }
+    cv::Mat img = cv::imread(readLocation);
+    if (img.empty()) {
+        setError(response, "Could not read image from " + readLocation);
+        return;
+    }
+
+    cannyEdgeDetection_parallel(img, ws, request.lowerThreshold, request.higherThreshold);
+
+    cv::Mat imgGrayscale(img.rows, img.cols, CV_8UC1, cv::Scalar(0));
+    arrayToImg(ws.pixelsCanny, (uint8_t*)imgGrayscale.data, img.rows, img.cols, 1);
+    if (!cv::imwrite(writeLocation, imgGrayscale)) {
+        setError(response, "Could not write image to " + writeLocation);
+    }
+}
+
+static void processShm(const DaemonRequest& request, CannyWorkspace& ws, DaemonResponse& response) {
+    int sizeRows = request.rows;
+    int sizeCols = request.cols;
+    int sizeDepth = request.depth;
+    if (sizeRows < 3 || sizeCols < 3 || (sizeDepth != 1 && sizeDepth != 3)) {
+        setError(response, "Invalid image geometry");
+        return;
+    }
+
+    int fd = shm_open(request.input, O_RDWR, 0);
+    if (fd < 0) {
+        setError(response, std::string("shm_open failed: ") + strerror(errno));
+        return;
+    }
+    size_t size = daemonShmSize(sizeRows, sizeCols, sizeDepth);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        close(fd);
+        setError(response, "Shared memory segment is too small");
+        return;
+    }
+    uint8_t* segment = (uint8_t*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        setError(response, std::string("mmap failed: ") + strerror(errno));
+        return;
+    }
+
+    cv::Mat img(sizeRows, sizeCols, sizeDepth == 3 ? CV_8UC3 : CV_8UC1, segment);
+    cannyEdgeDetection_parallel(img, ws, request.lowerThreshold, request.higherThreshold);
+
+    uint8_t* edges = segment + (size_t)sizeRows * sizeCols * sizeDepth;
+    arrayToImg(ws.pixelsCanny, edges, sizeRows, sizeCols, 1);
+
+    munmap(segment, size);
+}
+
+// Serve requests on one connection until the client hangs up
+static void serveConnection(int fd, CannyWorkspace& ws) {
+    DaemonRequest request;
+    while (readFull(fd, &request, sizeof(request))) {
+        double start = getCurrentTimeMs();
+        DaemonResponse response;
+        memset(&response, 0, sizeof(response));
+        response.magic = CANNY_DAEMON_MAGIC;
+        request.input[CANNY_DAEMON_NAME_LEN - 1] = '\0';
+        request.output[CANNY_DAEMON_NAME_LEN - 1] = '\0';
+
+        if (request.magic != CANNY_DAEMON_MAGIC) {
+            setError(response, "Bad request magic");
+            writeFull(fd, &response, sizeof(response));
+            return;
+        }
+
+        switch (request.op) {
+        case OP_PATH:
+            processPath(request, ws, response);
+            break;
+        case OP_SHM:
+            processShm(request, ws, response);
+            break;
+        case OP_STATS:
+            snprintf(response.message, sizeof(response.message), "%s", statsMessage().c_str());
+            break;
+        default:
+            setError(response, "Unknown op " + std::to_string(request.op));
+            break;
+        }
+
+        response.latencyMs = getCurrentTimeMs() - start;
+        if (request.op != OP_STATS) {
+            recordLatency(response.latencyMs, response.status == 0);
+        }
+        if (!writeFull(fd, &response, sizeof(response))) return;
+    }
+}
+
+// Connection handler. Each handler keeps its own workspace for its lifetime.
+// Remove a socket left behind by a daemon that is gone. Anything else at
+// the path (a regular file, or a socket a live daemon still answers on) is
+// left alone and reported.
+static bool removeStaleSocket(const sockaddr_un& addr, std::string& error) {
+    struct stat st;
+    if (lstat(addr.sun_path, &st) != 0) {
+        if (errno == ENOENT) return true;
+        error = strerror(errno);
+        return false;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        error = "path exists and is not a socket";
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool live = fd >= 0 && connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    if (fd >= 0) close(fd);
+    if (live) {
+        error = "another daemon is listening on it";
+        return false;
+    }
+    if (unlink(addr.sun_path) != 0 && errno != ENOENT) {
+        error = strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void* connectionWorker(void*) {
+    CannyWorkspace ws;
+    while (true) {
+        pthread_mutex_lock(&g_connMutex);
+        while (g_connections.empty() && !g_stop) {
+            pthread_cond_wait(&g_connReady, &g_connMutex);
+        }
+        if (g_connections.empty()) {
+            pthread_mutex_unlock(&g_connMutex);
+            break;
+        }
+        int fd = g_connections.front();
+        g_connections.pop_front();
+        pthread_mutex_unlock(&g_connMutex);
+
+        serveConnection(fd, ws);
+        close(fd);
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+    int numThreads = 1;
+    int numWorkers = 4;
+    std::string socketPath = getenv("CANNY_SOCKET") ? getenv("CANNY_SOCKET") : CANNY_DAEMON_SOCKET;
+
+    if (argc > 1) {
+        numThreads = std::atoi(argv[1]);
+        if (numThreads < 1) numThreads = 1;
+        if (numThreads > 16) numThreads = 16;
+    }
+
+    if (argc > 2) {
+        numWorkers = std::max(1, std::atoi(argv[2]));
+    }
+
+    if (argc > 3) {
+        socketPath = argv[3];
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path is too long\n";
+        return 1;
+    }
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    std::string error;
+    if (!removeStaleSocket(addr, error)) {
+        std::cerr << "Error: will not listen on " << socketPath << ": " << error << "\n";
+        return 1;
+    }
+
+    g_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (g_listenFd < 0 || bind(g_listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(g_listenFd, 128) != 0) {
+        std::cerr << "Error: could not listen on " << socketPath << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    // Identity of our socket file, so shutdown only removes it if still ours
+    struct stat bound;
+    lstat(socketPath.c_str(), &bound);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    setNumThreads(numThreads);
+    startWorkerPool(numThreads);
+
+    pthread_t workers[numWorkers];
+    for (int w = 0; w < numWorkers; w++) {
+        pthread_create(&workers[w], nullptr, connectionWorker, nullptr);
+    }
+
+    std::cout << "Canny daemon listening on " << socketPath << " (" << numThreads
+              << " thread(s), " << numWorkers << " connection worker(s))\n";
+
+    while (!g_stop) {
+        int fd = accept(g_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        timeval timeout = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        pthread_mutex_lock(&g_connMutex);
+        g_connections.push_back(fd);
+        pthread_cond_signal(&g_connReady);
+        pthread_mutex_unlock(&g_connMutex);
+    }
+
+    pthread_mutex_lock(&g_connMutex);
+    g_stop = 1;
+    pthread_cond_broadcast(&g_connReady);
+    pthread_mutex_unlock(&g_connMutex);
+    for (int w = 0; w < numWorkers; w++) {
+        pthread_join(workers[w], nullptr);
+    }
+
+    close(g_listenFd);
+    struct stat current;
+    if (lstat(socketPath.c_str(), &current) == 0 && S_ISSOCK(current.st_mode) &&
+        current.st_dev == bound.st_dev && current.st_ino == bound.st_ino) {
+        unlink(socketPath.c_str());
+    }
+    stopWorkerPool();
+
+    std::cout << "Shutting down: " << statsMessage() << "\n";
+
+    return 0;
+}
@@ -1,8 +1,12 @@
 #include <iostream>
+#include <algorithm>
 #include <cstdlib>
+#include <string>
+#include <thread>
 
 #include "canny.h"
 #include "canny_parallel.h"
+#include "canny_tuning.h"
 
 int main(int argc, char* argv[]) {
     std::string readLocation = "../images/Sukuna.jpg";
@@ -11,7 +15,12 @@ int main(int argc, char* argv[]) {
     double higherThreshold = 0.1;
     
     int numThreads = 1;
-    if (argc > 1) {
+    bool autoTune = false;
+    if (argc > 1 && std::string(argv[1]) == "auto") {
+        // Use every core as the budget and let the tuner split it per stage
+        autoTune = true;
+        numThreads = std::max(1, std::min((int)std::thread::hardware_concurrency(), 16));
+    } else if (argc > 1) {
         numThreads = std::atoi(argv[1]);
         if (numThreads < 1) numThreads = 1;
         if (numThreads > 16) numThreads = 16;
@@ -25,12 +34,70 @@ int main(int argc, char* argv[]) {
         writeLocation = argv[3];
     }
     
+    CannyPrecision precision = PRECISION_EXACT;
+    if (argc > 4) {
+        std::string mode = argv[4];
+        if (mode == "l1") precision = PRECISION_FAST_L1;
+        else if (mode == "l2sq") precision = PRECISION_FAST_L2SQ;
+        else if (mode != "exact") {
+            std::cout << "Unknown precision mode " << mode << " (expected exact, l1 or l2sq)\n";
+            return 1;
+        }
+    }
+    
+    PipelineMode pipeline = PIPELINE_CHANNEL_FIRST;
+    if (argc > 5) {
+        std::string mode = argv[5];
+        if (mode == "luma") pipeline = PIPELINE_LUMA_AVERAGE;
+        else if (mode == "bt601") pipeline = PIPELINE_LUMA_BT601;
+        else if (mode != "channel") {
+            std::cout << "Unknown pipeline mode " << mode << " (expected channel, luma or bt601)\n";
+            return 1;
+        }
+    }
+    
+    MemoryMode memory = MEMORY_DEFAULT;
+    if (argc > 6) {
+        std::string mode = argv[6];
+        if (mode == "low") memory = MEMORY_LOW;
+        else if (mode != "default") {
+            std::cout << "Unknown memory mode " << mode << " (expected default or low)\n";
+            return 1;
+        }
+    }
+    
+    SparsityMode sparsity = SPARSITY_DENSE;
+    if (argc > 7) {
+        std::string mode = argv[7];
+        if (mode == "skip") sparsity = SPARSITY_SKIP_FLAT;
+        else if (mode != "dense") {
+            std::cout << "Unknown sparsity mode " << mode << " (expected dense or skip)\n";
+            return 1;
+        }
+    }
+    
     std::cout << "Running Canny Edge Detection with " << numThreads << " thread(s)...\n";
     std::cout << "Input:  " << readLocation << "\n";
     std::cout << "Output: " << writeLocation << "\n";
+    std::cout << "Precision: " << precisionModeName(precision) << "\n";
+    std::cout << "Pipeline: " << pipelineModeName(pipeline) << "\n";
+    std::cout << "Backend: " << parallelBackendName(getParallelBackend()) << "\n";
+    std::cout << "Memory: " << memoryModeName(memory) << "\n";
+    std::cout << "Sparsity: " << sparsityModeName(sparsity) << "\n";
+    if (autoTune) std::cout << "Auto-tune: on (cache " << tuningCachePath() << ")\n";
     
     setNumThreads(numThreads);
+    setPrecisionMode(precision);
+    setPipelineMode(pipeline);
+    setMemoryMode(memory);
+    setSparsityMode(sparsity);
+    if (autoTune) setAutoTune(true);
     cannyEdgeDetection_parallel(readLocation, writeLocation, lowerThreshold, higherThreshold);
+    if (sparsity == SPARSITY_SKIP_FLAT && precision == PRECISION_EXACT) {
+        TileStats tiles = getLastTileStats();
+        std::cout << "Tiles skipped: " << tiles.skippedTiles << " / " << tiles.numTiles << "\n";
+    }
+    if (getAutoTune()) std::cout << "Tuning: " << formatTuningConfig(getTuningConfig()) << "\n";
     
     std::cout << "Done!\n";
     
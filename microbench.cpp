@@ -0,0 +1,351 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "canny.h"
+#include "canny_parallel.h"
+
+// Per-kernel microbenchmarks.
+//
+//   ./microbench [image] [runs]
+//
+// Every kernel runs single-threaded on buffers prepared beforehand, so only
+// the kernel itself is measured. Inputs a kernel modifies in place are
+// restored outside the measured region. Hardware counters come from
+// perf_event_open for the calling thread (user space only); where they are
+// not available (no PMU, perf_event_paranoid, containers) only time is shown.
+//
+// B/px is the compulsory traffic of a kernel: bytes read plus bytes written
+// per pixel if every buffer is touched exactly once. LLC B/px is the measured
+// last-level cache misses times the 64-byte line size. When LLC B/px is close
+// to B/px the kernel streams from memory; when it is far below, it runs from
+// cache and is compute-bound.
+
+const int DEFAULT_RUNS = 10;
+const int CACHE_LINE = 64;
+
+// ============================================================================
+// PERF COUNTERS
+// ============================================================================
+
+enum CounterId {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_COUNTERS,
+};
+
+struct PerfCounters {
+    int fds[NUM_COUNTERS];
+};
+
+static int openCounter(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Counters are opened one by one, so a PMU lacking one event keeps the others
+static void openCounters(PerfCounters& counters) {
+    uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        counters.fds[c] = openCounter(configs[c]);
+    }
+}
+
+static void closeCounters(PerfCounters& counters) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counters.fds[c] >= 0) close(counters.fds[c]);
+    }
+}
+
+static bool anyCounter(const PerfCounters& counters) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counters.fds[c] >= 0) return true;
+    }
+    return false;
+}
+
+static void startCounters(PerfCounters& counters) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counters.fds[c] < 0) continue;
+        ioctl(counters.fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters.fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// Adds the counts since startCounters to totals (scaled if the PMU was
+// multiplexed); -1 marks an unavailable counter
+static void stopCounters(PerfCounters& counters, double totals[NUM_COUNTERS]) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counters.fds[c] < 0) {
+            totals[c] = -1;
+            continue;
+        }
+        ioctl(counters.fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t values[3] = {0, 0, 0};  // value, time enabled, time running
+        if (read(counters.fds[c], values, sizeof(values)) != sizeof(values)) {
+            totals[c] = -1;
+            continue;
+        }
+        double scale = values[2] > 0 ? (double)values[1] / values[2] : 1.0;
+        if (totals[c] >= 0) totals[c] += values[0] * scale;
+    }
+}
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+
+// Buffers shared by the kernels, prepared once from the input image
+struct MicroBuffers {
+    cv::Mat img;
+    int sizeRows;
+    int sizeCols;
+    int sizeDepth;
+    std::vector<std::vector<double>> kernel;
+    double kernelConst;
+    std::vector<int> pixels;
+    std::vector<int> pixelsBlur;
+    std::vector<int> pixelsGray;
+    std::vector<double> gradient;      // after Sobel
+    std::vector<double> suppressed;    // after NMS
+    std::vector<double> G;             // working copy for in-place kernels
+    std::vector<int> theta;
+    std::vector<int> pixelsCanny;
+    double largestG;
+    pthread_mutex_t mutex;
+    ThreadData data;                   // one band covering the whole image
+    cv::Mat output;
+};
+
+struct Kernel {
+    const char* name;
+    double bytesPerPixel;
+    void (*prepare)(MicroBuffers&);  // untimed, before every run
+    void (*run)(MicroBuffers&);
+};
+
+static void prepareNothing(MicroBuffers&) {}
+
+static void runImgToArray(MicroBuffers& b) {
+    b.pixels = imgToArray(b.img, (uint8_t*)b.img.data, b.sizeRows, b.sizeCols, b.sizeDepth);
+}
+
+static void runBlur(MicroBuffers& b) {
+    gaussianBlur_parallel(b.pixels, b.kernel, b.kernelConst, b.sizeRows, b.sizeCols, b.sizeDepth, b.pixelsBlur);
+}
+
+static void runGray(MicroBuffers& b) {
+    rgbToGrayscale_parallel(b.pixelsBlur, b.sizeRows, b.sizeCols, b.sizeDepth, b.pixelsGray);
+}
+
+static void prepareSobel(MicroBuffers& b) {
+    b.largestG = 0;
+    b.data.G = b.G.data();
+}
+
+static void runSobel(MicroBuffers& b) {
+    cannyPhase1Worker(&b.data);
+}
+
+static void prepareNms(MicroBuffers& b) {
+    b.G = b.gradient;
+    b.data.G = b.G.data();
+}
+
+static void runNms(MicroBuffers& b) {
+    cannyPhase2Worker(&b.data);
+}
+
+static void prepareHysteresis(MicroBuffers& b) {
+    b.G = b.suppressed;
+}
+
+static void runHysteresis(MicroBuffers& b) {
+    cannyHysteresis(b.G.data(), b.pixelsCanny.data(), b.sizeRows, b.sizeCols, 0.03, 0.1, b.largestG);
+}
+
+static void runArrayToImg(MicroBuffers& b) {
+    arrayToImg(b.pixelsCanny, (uint8_t*)b.output.data, b.sizeRows, b.sizeCols, 1);
+}
+
+// Run the whole chain once, leaving every intermediate buffer filled
+static void prepareBuffers(MicroBuffers& b) {
+    b.sizeRows = b.img.rows;
+    b.sizeCols = b.img.cols;
+    b.sizeDepth = b.img.channels();
+    makeGaussianKernel(b.kernel, b.kernelConst);
+    b.output = cv::Mat(b.sizeRows, b.sizeCols, CV_8UC1, cv::Scalar(0));
+    pthread_mutex_init(&b.mutex, nullptr);
+
+    runImgToArray(b);
+    runBlur(b);
+    runGray(b);
+
+    size_t n = (size_t)b.sizeRows * b.sizeCols;
+    b.G.assign(n, 0.0);
+    b.theta.assign(n, 0);
+    b.pixelsCanny.assign(n, 0);
+
+    memset(&b.data, 0, sizeof(b.data));
+    b.data.startRow = 0;
+    b.data.endRow = b.sizeRows;
+    b.data.numThreads = 1;
+    b.data.sizeRows = b.sizeRows;
+    b.data.sizeCols = b.sizeCols;
+    b.data.sizeDepth = 1;
+    b.data.inputPixels = &b.pixelsGray;
+    b.data.outputPixels = &b.pixelsCanny;
+    b.data.theta = &b.theta;
+    b.data.largestG = &b.largestG;
+    b.data.mutex = &b.mutex;
+
+    prepareSobel(b);
+    runSobel(b);
+    // Border pixels copied from their neighbours, as cannyFilter does
+    double* G = b.G.data();
+    int cols = b.sizeCols;
+    for (int j = 1; j < cols - 1; j++) {
+        G[j] = G[cols + j];
+        b.theta[j] = b.theta[cols + j];
+        G[(b.sizeRows - 1) * cols + j] = G[(b.sizeRows - 2) * cols + j];
+        b.theta[(b.sizeRows - 1) * cols + j] = b.theta[(b.sizeRows - 2) * cols + j];
+    }
+    for (int i = 0; i < b.sizeRows; i++) {
+        G[i * cols] = G[i * cols + 1];
+        b.theta[i * cols] = b.theta[i * cols + 1];
+        G[i * cols + cols - 1] = G[i * cols + cols - 2];
+        b.theta[i * cols + cols - 1] = b.theta[i * cols + cols - 2];
+    }
+    b.gradient = b.G;
+    runNms(b);
+    b.suppressed = b.G;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::string imagePath = "../images/Sukuna.jpg";
+    int runs = DEFAULT_RUNS;
+    if (argc > 1) imagePath = argv[1];
+    if (argc > 2) runs = std::max(1, std::atoi(argv[2]));
+
+    MicroBuffers b;
+    b.img = cv::imread(imagePath);
+    if (b.img.empty()) {
+        std::cerr << "Error: Could not read image from " << imagePath << "\n";
+        return 1;
+    }
+    setNumThreads(1);
+    prepareBuffers(b);
+    double pixels = (double)b.sizeRows * b.sizeCols;
+    int depth = b.sizeDepth;
+
+    // Compulsory bytes per pixel: reads + writes of each buffer once
+    Kernel kernels[] = {
+        {"imgToArray", depth * 1.0 + depth * 4.0, prepareNothing, runImgToArray},
+        {"blur", depth * 4.0 + depth * 4.0, prepareNothing, runBlur},
+        {"grayscale", depth * 4.0 + 4.0, prepareNothing, runGray},
+        {"sobel", 4.0 + 8.0 + 4.0, prepareSobel, runSobel},
+        {"nms", 8.0 + 4.0 + 8.0 + 4.0, prepareNms, runNms},
+        {"hysteresis", 8.0 + 8.0 + 4.0, prepareHysteresis, runHysteresis},
+        {"arrayToImg", 4.0 + 1.0, prepareNothing, runArrayToImg},
+    };
+
+    PerfCounters counters;
+    openCounters(counters);
+    bool haveCounters = anyCounter(counters);
+
+    std::cout << "Image: " << imagePath << " (" << b.sizeCols << "x" << b.sizeRows << "x" << depth << ")\n";
+    std::cout << "Runs per kernel: " << runs << ", single thread\n";
+    if (!haveCounters) {
+        std::cout << "Hardware counters unavailable (perf_event_open: " << strerror(errno)
+                  << "), reporting time only\n";
+    }
+
+    std::cout << "\n";
+    std::cout << "========================================================================================================================\n";
+    std::cout << std::setw(12) << "Kernel"
+              << std::setw(11) << "Time (ms)"
+              << std::setw(9) << "ns/px"
+              << std::setw(8) << "B/px"
+              << std::setw(9) << "GB/s"
+              << std::setw(11) << "Cycles/px"
+              << std::setw(9) << "Instr/px"
+              << std::setw(7) << "IPC"
+              << std::setw(10) << "LLC B/px"
+              << std::setw(14) << "LLC miss/px"
+              << std::setw(16) << "Branch miss/px" << "\n";
+    std::cout << "------------------------------------------------------------------------------------------------------------------------\n";
+
+    for (const Kernel& k : kernels) {
+        // Warm-up
+        k.prepare(b);
+        k.run(b);
+
+        double time = 0;
+        double totals[NUM_COUNTERS] = {0, 0, 0, 0};
+        for (int r = 0; r < runs; r++) {
+            k.prepare(b);
+            startCounters(counters);
+            double start = getCurrentTimeMs();
+            k.run(b);
+            time += getCurrentTimeMs() - start;
+            stopCounters(counters, totals);
+        }
+        time /= runs;
+        double perPixel[NUM_COUNTERS];
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            perPixel[c] = totals[c] >= 0 ? totals[c] / runs / pixels : -1;
+        }
+
+        std::cout << std::setw(12) << k.name
+                  << std::setw(11) << std::fixed << std::setprecision(3) << time
+                  << std::setw(9) << std::fixed << std::setprecision(2) << time * 1e6 / pixels
+                  << std::setw(8) << std::fixed << std::setprecision(0) << k.bytesPerPixel
+                  << std::setw(9) << std::fixed << std::setprecision(2) << k.bytesPerPixel * pixels / (time * 1e6);
+
+        auto column = [](int width, int precision, double value) {
+            if (value < 0) {
+                std::cout << std::setw(width) << "n/a";
+            } else {
+                std::cout << std::setw(width) << std::fixed << std::setprecision(precision) << value;
+            }
+        };
+        double cycles = perPixel[COUNTER_CYCLES];
+        double instructions = perPixel[COUNTER_INSTRUCTIONS];
+        double llc = perPixel[COUNTER_LLC_MISSES];
+        column(11, 2, cycles);
+        column(9, 2, instructions);
+        column(7, 2, cycles > 0 && instructions >= 0 ? instructions / cycles : -1);
+        column(10, 2, llc >= 0 ? llc * CACHE_LINE : -1);
+        column(14, 4, llc);
+        column(16, 4, perPixel[COUNTER_BRANCH_MISSES]);
+        std::cout << "\n";
+    }
+    std::cout << "========================================================================================================================\n";
+
+    closeCounters(counters);
+    pthread_mutex_destroy(&b.mutex);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+
+#include "canny_parallel.h"
+#include "canny_shard.h"
+
+// Sharded multi-process run: canny_shard <shards> <threads_per_shard> <in> <out> [pin]
+int main(int argc, char* argv[]) {
+    std::string readLocation = "../images/Sukuna.jpg";
+    std::string writeLocation = "../images/SukunaCanny.jpg";
+    double lowerThreshold = 0.03;
+    double higherThreshold = 0.1;
+
+    int numShards = 2;
+    if (argc > 1) {
+        numShards = std::atoi(argv[1]);
+        if (numShards < 1) numShards = 1;
+        if (numShards > MAX_SHARDS) numShards = MAX_SHARDS;
+    }
+
+    int threadsPerShard = 1;
+    if (argc > 2) {
+        threadsPerShard = std::atoi(argv[2]);
+        if (threadsPerShard < 1) threadsPerShard = 1;
+        if (threadsPerShard > 16) threadsPerShard = 16;
+    }
+
+    if (argc > 3) {
+        readLocation = argv[3];
+    }
+
+    if (argc > 4) {
+        writeLocation = argv[4];
+    }
+
+    bool pinWorkers = false;
+    if (argc > 5) {
+        std::string mode = argv[5];
+        if (mode == "pin") pinWorkers = true;
+        else if (mode != "nopin") {
+            std::cout << "Unknown pinning mode " << mode << " (expected pin or nopin)\n";
+            return 1;
+        }
+    }
+
+    cv::Mat img = cv::imread(readLocation);
+    if (img.empty()) {
+        std::cout << "Could not read " << readLocation << "\n";
+        return 1;
+    }
+
+    std::cout << "Running sharded Canny Edge Detection with " << numShards << " process(es) x "
+              << threadsPerShard << " thread(s)...\n";
+    std::cout << "Input:  " << readLocation << "\n";
+    std::cout << "Output: " << writeLocation << "\n";
+    std::cout << "Pinning: " << (pinWorkers ? "on" : "off") << "\n";
+
+    std::string error;
+    ShardSegment segment;
+    if (!createShardSegment(img.rows, img.cols, img.channels(), numShards, segment, error)) {
+        std::cout << "Error: " << error << "\n";
+        return 1;
+    }
+    img.copyTo(segment.input);
+
+    ShardStats stats;
+    bool ok = runShards(segment, threadsPerShard, lowerThreshold, higherThreshold, pinWorkers, error, &stats);
+    if (ok) {
+        // The edge map is already assembled in the segment
+        cv::imwrite(writeLocation, segment.edges);
+        std::cout << "Time: " << stats.totalTime << " ms\n";
+        std::cout << "Seams: " << stats.nmsRowsPatched << " NMS row(s) redone, "
+                  << stats.hysteresisPatched << " pixel(s) promoted across shards\n";
+        std::cout << "Done!\n";
+    } else {
+        std::cout << "Error: " << error << "\n";
+    }
+    destroyShardSegment(segment);
+
+    return ok ? 0 : 1;
+}